@@ -0,0 +1,308 @@
+// Batch analysis: streams multiplication_save.txt style positions from files
+// or directories of files, searches them on all cores and writes the best
+// factor, score and principal variation of each as CSV or JSON lines, in
+// input order. Input files are mmapped and parsed in place, and only a
+// bounded window of positions is held at once, however long the input.
+#include "gamecore.h"
+#include "savefile.h"
+#include "search.h"
+#include "tt.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct AnalyzeOptions {
+    std::vector<std::string> inputs;       // files and directories, in order
+    std::string output;                    // empty: stdout
+    std::string format = "csv";            // csv or json
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    int depth = 8;
+    int thinkMs = 0;                       // 0: depth only, so results do not depend on timing
+    int hashMb = 2;                        // per worker, cleared for every position
+};
+
+enum AnalysisStatus { STATUS_OK, STATUS_OVER, STATUS_INVALID };
+const char *STATUS_NAMES[] = {"ok", "over", "invalid"};
+
+// One position on its way through the pipeline
+struct Analysis {
+    size_t file = 0;                       // index into the list of input files
+    size_t entry = 0;                      // position number within that file
+    Position pos;
+    AnalysisStatus status = STATUS_OK;
+    int side = NO_PLAYER;                  // to move after forced passes, or the result once over
+    SearchResult result;
+    std::vector<int> pv;
+    bool done = false;
+};
+
+// Read-only mapping of a whole file, read ahead sequentially by the kernel
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile(){ close(); }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path){
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0) return false;
+        struct stat st;
+        if(fstat(fd, &st) != 0){
+            ::close(fd);
+            return false;
+        }
+        size = st.st_size;
+        if(size > 0){
+            void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(map == MAP_FAILED){
+                ::close(fd);
+                size = 0;
+                return false;
+            }
+            madvise(map, size, MADV_SEQUENTIAL);
+            data = (const char *)map;
+        }
+        ::close(fd);
+        return true;
+    }
+
+    void close(){
+        if(data) munmap((void *)data, size);
+        data = nullptr;
+        size = 0;
+    }
+
+    const char *begin() const { return data; }
+    const char *end() const { return data + size; }
+
+private:
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+// Regular files named by `inputs`, directories expanded to their files in name order
+bool listInputFiles(const std::vector<std::string> &inputs, std::vector<std::string> &files){
+    for(const std::string &input : inputs){
+        struct stat st;
+        if(stat(input.c_str(), &st) != 0) return false;
+        if(!S_ISDIR(st.st_mode)){
+            files.push_back(input);
+            continue;
+        }
+        DIR *dir = opendir(input.c_str());
+        if(!dir) return false;
+        std::vector<std::string> names;
+        while(dirent *entry = readdir(dir)){
+            std::string path = input + "/" + entry->d_name;
+            if(entry->d_name[0] != '.' && stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) names.push_back(path);
+        }
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+        files.insert(files.end(), names.begin(), names.end());
+    }
+    return true;
+}
+
+// Each position gets a cleared table, so the output is the same on any number of threads
+void analyze(Analysis &a, TranspositionTable &table, const AnalyzeOptions &options){
+    if(a.status == STATUS_INVALID) return;
+    Game game(a.pos);
+    if(game.isOver()){
+        a.status = STATUS_OVER;
+        a.side = game.result();
+        return;
+    }
+    a.side = game.sideToMove();
+    table.clear();
+    SearchLimits limits;
+    limits.timeMs = options.thinkMs > 0 ? options.thinkMs : INT_MAX;
+    limits.maxDepth = options.depth;
+    limits.table = &table;
+    a.result = searchBestFactor(game.position(), limits);
+    a.pv = principalVariation(game.position(), table, a.result.factor, std::max(1, a.result.depth));
+}
+
+const char *sideName(int side){
+    return side == HUMAN_PLAYER ? "human" : side == COMPUTER_PLAYER ? "computer" : side == DRAW_RESULT ? "draw" : "";
+}
+
+// File names are the only free text in the output
+std::string quoted(const std::string &text, bool json){
+    std::string out = "\"";
+    for(char c : text){
+        if(json && (c == '"' || c == '\\')) out += '\\';
+        else if(!json && c == '"') out += '"';
+        if(json && (unsigned char)c < 0x20){
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+            out += escape;
+        }else{
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+void writeAnalysis(FILE *out, const Analysis &a, size_t index, const std::string &file, bool json){
+    std::string pv;
+    for(size_t i = 0; i < a.pv.size(); i++){
+        if(i) pv += json ? "," : " ";
+        pv += std::to_string(a.pv[i]);
+    }
+    const SearchResult &r = a.result;
+    if(json){
+        std::fprintf(out, "{\"index\": %zu, \"file\": %s, \"entry\": %zu, \"status\": \"%s\", \"side\": \"%s\", "
+                          "\"factor\": %d, \"score\": %d, \"depth\": %d, \"nodes\": %llu, \"pv\": [%s]}\n",
+                     index, quoted(file, true).c_str(), a.entry, STATUS_NAMES[a.status], sideName(a.side),
+                     r.factor, r.score, r.depth, (unsigned long long)r.nodes, pv.c_str());
+    }else{
+        std::fprintf(out, "%zu,%s,%zu,%s,%s,%d,%d,%d,%llu,%s\n", index, quoted(file, false).c_str(), a.entry,
+                     STATUS_NAMES[a.status], sideName(a.side), r.factor, r.score, r.depth,
+                     (unsigned long long)r.nodes, pv.c_str());
+    }
+}
+
+bool parseOptions(int argc, char **argv, AnalyzeOptions &options){
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(i + 1 >= argc) return false;
+        const char *value = argv[++i];
+        if(arg == "--from") options.inputs.push_back(value);
+        else if(arg == "--output") options.output = value;
+        else if(arg == "--format") options.format = value;
+        else if(arg == "--threads") options.threads = std::atoi(value);
+        else if(arg == "--depth") options.depth = std::atoi(value);
+        else if(arg == "--think-ms") options.thinkMs = std::atoi(value);
+        else if(arg == "--hash") options.hashMb = std::atoi(value);
+        else return false;
+    }
+    return !options.inputs.empty() && options.threads > 0 && options.depth > 0 && options.depth <= MAX_SEARCH_DEPTH
+        && options.thinkMs >= 0 && options.hashMb > 0 && (options.format == "csv" || options.format == "json");
+}
+
+} // namespace
+
+int main(int argc, char **argv){
+    AnalyzeOptions options;
+    if(!parseOptions(argc, argv, options)){
+        std::fprintf(stderr, "Usage: %s --from file|directory... [--output file] [--format csv|json]\n"
+                             "          [--threads n] [--depth n] [--think-ms ms] [--hash MB]\n", argv[0]);
+        return 1;
+    }
+    std::vector<std::string> files;
+    if(!listInputFiles(options.inputs, files)){
+        std::fprintf(stderr, "Could not read the input files\n");
+        return 1;
+    }
+    FILE *out = options.output.empty() ? stdout : std::fopen(options.output.c_str(), "w");
+    if(!out){
+        std::fprintf(stderr, "Could not write %s\n", options.output.c_str());
+        return 1;
+    }
+    const bool json = options.format == "json";
+    if(!json) std::fprintf(out, "index,file,entry,status,side,factor,score,depth,nodes,pv\n");
+
+    // Positions live in a ring of `window` slots: the main thread parses into
+    // free slots and writes finished ones in order, the workers fill them in
+    const size_t window = (size_t)options.threads * 64;
+    std::vector<Analysis> slots(window);
+    size_t parsed = 0, claimed = 0, written = 0;
+    bool inputDone = false;
+    std::mutex mutex;
+    std::condition_variable workReady, resultReady;
+
+    std::vector<std::thread> workers;
+    for(int t = 0; t < options.threads; t++){
+        workers.emplace_back([&](){
+            TranspositionTable table(options.hashMb);
+            std::unique_lock<std::mutex> lock(mutex);
+            for(;;){
+                workReady.wait(lock, [&](){ return claimed < parsed || inputDone; });
+                if(claimed == parsed) return;
+                Analysis &a = slots[claimed++ % window];
+                lock.unlock();
+                analyze(a, table, options);
+                lock.lock();
+                a.done = true;
+                resultReady.notify_one();
+            }
+        });
+    }
+
+    auto writeFinished = [&](){
+        while(written < parsed && slots[written % window].done){
+            Analysis &a = slots[written % window];
+            writeAnalysis(out, a, written, files[a.file], json);
+            a.done = false;
+            written++;
+        }
+    };
+
+    auto begin = std::chrono::steady_clock::now();
+    size_t invalid = 0;
+    MappedFile mapped;
+    for(size_t f = 0; f < files.size(); f++){
+        if(!mapped.open(files[f])){
+            std::fprintf(stderr, "Could not read %s\n", files[f].c_str());
+            continue;
+        }
+        const char *cursor = mapped.begin();
+        for(size_t entry = 0;; entry++){
+            Position pos;
+            TextParseResult parse = parseTextPosition(cursor, mapped.end(), pos);
+            if(parse == TEXT_END) break;
+            if(parse == TEXT_INVALID) invalid++;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            for(;;){
+                writeFinished();
+                if(parsed - written < window) break;
+                resultReady.wait(lock);
+            }
+            Analysis &a = slots[parsed % window];
+            a = Analysis();
+            a.file = f;
+            a.entry = entry;
+            a.pos = pos;
+            a.status = parse == TEXT_VALID ? STATUS_OK : STATUS_INVALID;
+            parsed++;
+            workReady.notify_one();
+        }
+        // Slots still in the window refer to the file by index, not into the mapping
+        mapped.close();
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        inputDone = true;
+        workReady.notify_all();
+        for(;;){
+            writeFinished();
+            if(written == parsed) break;
+            resultReady.wait(lock);
+        }
+    }
+    for(auto &worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    bool ok = std::fflush(out) == 0;
+    if(out != stdout) ok = std::fclose(out) == 0 && ok;
+    std::fprintf(stderr, "Analyzed %zu positions from %zu files in %.1f s (%.0f positions/sec), %zu invalid\n",
+                 parsed, files.size(), seconds, parsed / std::max(seconds, 1e-9), invalid);
+    return ok ? 0 : 1;
+}
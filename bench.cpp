@@ -0,0 +1,228 @@
+// Microbenchmarks for the rule and engine hot paths, timed on a corpus of
+// mid-game positions. Prints a table, CSV or JSON so runs can be compared.
+#include "game.h"
+#include "board.h"
+#include "utils.h"
+#include "config.h"
+#include "gamecore.h"
+#include "movescore.h"
+#include "search.h"
+#include "tt.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchOptions {
+    int positions = 500;           // generated corpus size
+    int samples = 10;              // timed passes over the corpus per benchmark
+    int depth = 3;                 // alpha-beta depth for computerChooseFactor
+    uint64_t seed = 1;
+    std::string format = "text";   // text, csv or json
+    std::string filter;            // run only benchmarks whose name contains this
+    std::string kernel;            // evaluateMoves() kernel, the fastest supported one if empty
+    std::vector<std::string> fromFiles;
+};
+
+struct Benchmark {
+    const char *name;
+    bool usesBoard;        // needs the position copied into the UI globals first
+    int callsPerPosition;
+    int (*run)(const Position &pos, int i);
+};
+
+struct BenchResult {
+    const char *name;
+    uint64_t ops;
+    double meanNs;         // per op, averaged over the samples
+    double varianceNs;     // between samples
+};
+
+volatile int sink;
+
+const Benchmark BENCHMARKS[] = {
+    {"checkWinCondition", true, 64, [](const Position &, int){ return checkWinCondition(); }},
+    {"checkLine", true, 288, [](const Position &, int i){
+        int cell = i % NUM_CELLS;
+        const int *dir = directions[(i / NUM_CELLS) % 4];
+        return (int)checkLine(cell / BOARD_SIZE, cell % BOARD_SIZE, dir[0], dir[1], 1 + (i & 1));
+    }},
+    {"isValidMove", true, 288, [](const Position &pos, int i){
+        return (int)isValidMove(pos.activeFactor * (1 + i % MAX_FACTOR));
+    }},
+    {"wouldWin", true, 288, [](const Position &pos, int i){
+        return (int)wouldWin(pos.activeFactor * (1 + i % MAX_FACTOR), pos.sideToMove);
+    }},
+    {"evaluateMove", true, 288, [](const Position &pos, int i){
+        return evaluateMove(pos.activeFactor * (1 + i % MAX_FACTOR), pos.sideToMove);
+    }},
+    {"evaluateMoves", true, 32, [](const Position &pos, int i){
+        // Every factor of the active one in a single call, the greedy engine's whole move list
+        int products[MAX_FACTOR], scores[MAX_FACTOR];
+        for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++) products[f - MIN_FACTOR] = pos.activeFactor * f;
+        evaluateMoves(products, MAX_FACTOR, 1 + (i & 1), scores);
+        return scores[i % MAX_FACTOR];
+    }},
+    {"computerChooseFactor", true, 1, [](const Position &pos, int){
+        GameState state;
+        state.activeFactor = pos.activeFactor;
+        state.humanTurn = pos.sideToMove == HUMAN_PLAYER;
+        return computerChooseFactor(state);
+    }},
+    {"core:legalMoves", false, 288, [](const Position &pos, int i){
+        return (int)legalMoves(pos) + i;
+    }},
+    {"core:wonAt", false, 288, [](const Position &pos, int i){
+        return (int)wonAt(pos, i % NUM_CELLS, pos.sideToMove);
+    }},
+    {"core:evaluatePosition", false, 64, [](const Position &pos, int){ return evaluatePosition(pos); }},
+    {"core:greedyFactor", false, 16, [](const Position &pos, int){ return greedyFactor(pos); }},
+};
+
+// Mid-game positions from seeded games mixing greedy and random moves
+std::vector<Position> generateCorpus(int count, uint64_t seed){
+    std::vector<Position> corpus;
+    uint64_t rng = seed;
+    while((int)corpus.size() < count){
+        Game game(MIN_FACTOR + (int)(splitmix64(rng) % MAX_FACTOR),
+                  splitmix64(rng) % 2 ? HUMAN_PLAYER : COMPUTER_PLAYER);
+        int stopAt = 4 + (int)(splitmix64(rng) % 13);
+        while(!game.isOver() && game.moves() < stopAt){
+            const Position &pos = game.position();
+            game.play(splitmix64(rng) % 2 ? greedyFactor(pos) : randomFactor(pos, rng));
+        }
+        if(!game.isOver()) corpus.push_back(game.position());
+    }
+    return corpus;
+}
+
+void loadIntoBoard(const Position &pos){
+    resetGameMarkings();
+    for(int p = HUMAN_PLAYER; p <= COMPUTER_PLAYER; p++){
+        for(Bitboard b = pos.bits[p]; b; b &= b - 1) placeMark(lowestCell(b), p);
+    }
+}
+
+BenchResult runBenchmark(const Benchmark &bench, const std::vector<Position> &corpus, int samples){
+    std::vector<double> perOp;
+    uint64_t ops = 0;
+    for(int s = 0; s < samples; s++){
+        searchTable.clear();
+        Clock::duration elapsed = Clock::duration::zero();
+        uint64_t sampleOps = 0;
+        int acc = 0;
+        for(const Position &pos : corpus){
+            if(bench.usesBoard) loadIntoBoard(pos);
+            Clock::time_point start = Clock::now();
+            for(int i = 0; i < bench.callsPerPosition; i++) acc += bench.run(pos, i);
+            elapsed += Clock::now() - start;
+            sampleOps += bench.callsPerPosition;
+        }
+        sink = acc;
+        perOp.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / sampleOps);
+        ops += sampleOps;
+    }
+    double mean = 0.0, variance = 0.0;
+    for(double ns : perOp) mean += ns;
+    mean /= perOp.size();
+    for(double ns : perOp) variance += (ns - mean) * (ns - mean);
+    variance /= perOp.size() > 1 ? perOp.size() - 1 : 1;
+    return {bench.name, ops, mean, variance};
+}
+
+void printResults(const std::vector<BenchResult> &results, const BenchOptions &options, size_t corpusSize){
+    if(options.format == "csv"){
+        std::printf("name,ops,ns_per_op,ops_per_sec,variance_ns2,stddev_ns\n");
+        for(const BenchResult &r : results){
+            std::printf("%s,%llu,%.3f,%.0f,%.6f,%.3f\n", r.name, (unsigned long long)r.ops, r.meanNs,
+                        1e9 / r.meanNs, r.varianceNs, std::sqrt(r.varianceNs));
+        }
+    }else if(options.format == "json"){
+        std::printf("{\"positions\": %zu, \"samples\": %d, \"depth\": %d, \"seed\": %llu, \"results\": [",
+                    corpusSize, options.samples, options.depth, (unsigned long long)options.seed);
+        for(size_t i = 0; i < results.size(); i++){
+            const BenchResult &r = results[i];
+            std::printf("%s\n  {\"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.3f, \"ops_per_sec\": %.0f, "
+                        "\"variance_ns2\": %.6f, \"stddev_ns\": %.3f}", i ? "," : "", r.name,
+                        (unsigned long long)r.ops, r.meanNs, 1e9 / r.meanNs, r.varianceNs, std::sqrt(r.varianceNs));
+        }
+        std::printf("\n]}\n");
+    }else{
+        std::printf("%zu positions, %d samples\n", corpusSize, options.samples);
+        std::printf("%-24s %14s %14s %10s\n", "benchmark", "ns/op", "ops/sec", "stddev");
+        for(const BenchResult &r : results){
+            std::printf("%-24s %14.1f %14.0f %9.1f%%\n", r.name, r.meanNs, 1e9 / r.meanNs,
+                        100.0 * std::sqrt(r.varianceNs) / r.meanNs);
+        }
+    }
+}
+
+bool parseOptions(int argc, char **argv, BenchOptions &options){
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(i + 1 >= argc) return false;
+        const char *value = argv[++i];
+        if(arg == "--positions") options.positions = std::atoi(value);
+        else if(arg == "--samples") options.samples = std::atoi(value);
+        else if(arg == "--depth") options.depth = std::atoi(value);
+        else if(arg == "--seed") options.seed = std::strtoull(value, nullptr, 10);
+        else if(arg == "--format") options.format = value;
+        else if(arg == "--filter") options.filter = value;
+        else if(arg == "--from") options.fromFiles.push_back(value);
+        else if(arg == "--kernel") options.kernel = value;
+        else return false;
+    }
+    return options.positions >= 0 && options.samples > 0 && options.depth > 0
+        && (options.format == "text" || options.format == "csv" || options.format == "json");
+}
+
+} // namespace
+
+int main(int argc, char **argv){
+    BenchOptions options;
+    if(!parseOptions(argc, argv, options)){
+        std::fprintf(stderr, "Usage: %s [--positions n] [--samples n] [--depth n] [--seed n]\n"
+                             "          [--format text|csv|json] [--filter name] [--from save_file]... [--kernel name]\n", argv[0]);
+        return 1;
+    }
+    if(!options.kernel.empty() && !useMoveScoreKernel(options.kernel)){
+        std::string supported;
+        for(const std::string &kernel : moveScoreKernels()) supported += " " + kernel;
+        std::fprintf(stderr, "Unknown or unsupported kernel %s; this CPU runs:%s\n", options.kernel.c_str(),
+                     supported.c_str());
+        return 1;
+    }
+
+    std::vector<Position> corpus = generateCorpus(options.positions, options.seed);
+    for(const std::string &path : options.fromFiles){
+        Position pos;
+        if(!readSaveFile(path, pos)){
+            std::fprintf(stderr, "Could not read position from %s\n", path.c_str());
+            return 1;
+        }
+        corpus.push_back(pos);
+    }
+    if(corpus.empty()){
+        std::fprintf(stderr, "No positions to benchmark\n");
+        return 1;
+    }
+
+    // Fixed-depth search so computerChooseFactor costs the same on every run
+    gameConfig.engine = ENGINE_ALPHABETA;
+    gameConfig.maxDepth = options.depth;
+    gameConfig.thinkMs = 600000;
+
+    std::vector<BenchResult> results;
+    for(const Benchmark &bench : BENCHMARKS){
+        if(!options.filter.empty() && std::string(bench.name).find(options.filter) == std::string::npos) continue;
+        results.push_back(runBenchmark(bench, corpus, options.samples));
+    }
+    printResults(results, options, corpus.size());
+    return 0;
+}
@@ -0,0 +1,129 @@
+// bitboard.h
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <array>
+#include <cstdint>
+#include "constants.h"
+
+const int NUM_CELLS = BOARD_SIZE * BOARD_SIZE;
+static_assert(NUM_CELLS <= 128, "board must fit in a 128-bit word");
+
+// One bit per cell, cell index = row * BOARD_SIZE + col; boards past 8x8 use
+// a 128-bit word so every mask operation stays a couple of instructions
+#if MG_BOARD_SIZE * MG_BOARD_SIZE <= 64
+typedef uint64_t Bitboard;
+#else
+typedef unsigned __int128 Bitboard;
+#endif
+
+inline int popCount(Bitboard b){
+    if(sizeof(Bitboard) == 8) return __builtin_popcountll((uint64_t)b);
+    return __builtin_popcountll((uint64_t)b) + __builtin_popcountll((uint64_t)(b >> 32 >> 32));
+}
+
+// Index of the lowest set bit; `b` must not be empty
+inline int lowestCell(Bitboard b){
+    if(sizeof(Bitboard) == 8 || (uint64_t)b) return __builtin_ctzll((uint64_t)b);
+    return 64 + __builtin_ctzll((uint64_t)(b >> 32 >> 32));
+}
+
+// Products fill the board row by row from cell 0, so blank cells are at the end
+const int NUM_PLAYABLE_CELLS = countDistinctProducts();
+
+constexpr Bitboard cellBit(int r, int c){
+    return Bitboard(1) << (r * BOARD_SIZE + c);
+}
+
+constexpr bool isPlayableCell(int r, int c){
+    return r * BOARD_SIZE + c < NUM_PLAYABLE_CELLS;
+}
+
+// True if a WIN_LENGTH line starting at (r, c) along (dr, dc) fits on the board and has no blank cell
+constexpr bool lineFits(int r, int c, int dr, int dc){
+    for(int k = 0; k < WIN_LENGTH; k++){
+        int lr = r + k * dr;
+        int lc = c + k * dc;
+        if(lr < 0 || lr >= BOARD_SIZE || lc < 0 || lc >= BOARD_SIZE || !isPlayableCell(lr, lc)) return false;
+    }
+    return true;
+}
+
+// Number of WIN_LENGTH lines fitting in the board along (dr, dc)
+constexpr int countLines(int dr, int dc){
+    int count = 0;
+    for(int r = 0; r < BOARD_SIZE; r++){
+        for(int c = 0; c < BOARD_SIZE; c++){
+            if(lineFits(r, c, dr, dc)) count++;
+        }
+    }
+    return count;
+}
+
+const int NUM_WIN_LINES = countLines(1, 0) + countLines(0, 1) + countLines(1, 1) + countLines(1, -1);
+
+// Every horizontal, vertical and diagonal WIN_LENGTH line as a cell mask
+constexpr std::array<Bitboard, NUM_WIN_LINES> buildWinLines(){
+    std::array<Bitboard, NUM_WIN_LINES> lines{};
+    const int dirs[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+    int n = 0;
+    for(auto &dir : dirs){
+        for(int r = 0; r < BOARD_SIZE; r++){
+            for(int c = 0; c < BOARD_SIZE; c++){
+                if(!lineFits(r, c, dir[0], dir[1])) continue;
+                Bitboard mask = 0;
+                for(int k = 0; k < WIN_LENGTH; k++){
+                    mask |= cellBit(r + k * dir[0], c + k * dir[1]);
+                }
+                lines[n++] = mask;
+            }
+        }
+    }
+    return lines;
+}
+
+constexpr std::array<Bitboard, NUM_WIN_LINES> WIN_LINES = buildWinLines();
+
+// At most WIN_LENGTH lines per direction pass through a single cell
+const int MAX_LINES_PER_CELL = 4 * WIN_LENGTH;
+
+struct CellLines {
+    int count;
+    Bitboard masks[MAX_LINES_PER_CELL];
+    uint16_t index[MAX_LINES_PER_CELL];   // position of each mask in WIN_LINES
+};
+
+// Win lines passing through each cell, so a move only has to test its own lines
+constexpr std::array<CellLines, NUM_CELLS> buildCellLines(){
+    std::array<CellLines, NUM_CELLS> table{};
+    for(int cell = 0; cell < NUM_CELLS; cell++){
+        Bitboard bit = Bitboard(1) << cell;
+        for(int i = 0; i < NUM_WIN_LINES; i++){
+            if(!(WIN_LINES[i] & bit)) continue;
+            table[cell].masks[table[cell].count] = WIN_LINES[i];
+            table[cell].index[table[cell].count++] = (uint16_t)i;
+        }
+    }
+    return table;
+}
+
+constexpr std::array<CellLines, NUM_CELLS> CELL_LINES = buildCellLines();
+
+// True if a line through `cell` is complete in the bitboard
+inline bool hasWinLineThrough(Bitboard bits, int cell){
+    const CellLines &lines = CELL_LINES[cell];
+    for(int i = 0; i < lines.count; i++){
+        if((bits & lines.masks[i]) == lines.masks[i]) return true;
+    }
+    return false;
+}
+
+// True if the bitboard contains a complete line
+inline bool hasWinLine(Bitboard bits){
+    for(Bitboard line : WIN_LINES){
+        if((bits & line) == line) return true;
+    }
+    return false;
+}
+
+#endif
@@ -1,125 +1,147 @@
 #include "board.h"
 #include "utils.h"
 #include "game.h"
+#include "movegen.h"
+#include "config.h"
+#include "metrics.h"
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <limits>
 #include <string>
 
 int board[BOARD_SIZE][BOARD_SIZE];
-int moveOwner[BOARD_SIZE][BOARD_SIZE] = {0};
+Bitboard playerBits[3] = {0, 0, 0};
+int liveLines[3] = {0, NUM_WIN_LINES, NUM_WIN_LINES};
 
 // Initialize Board with predefined non-prime numbers (and single-digit primes)
 void initializeBoard(){
-    const std::vector<int> nums = {
-        1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 12, 14,
-        15, 16, 18, 20, 21, 24, 25, 27, 28, 30, 32, 35,
-        36, 40, 42, 45, 48, 49, 54, 56, 63, 64, 72, 81};
-    int index = 0;
     for(int i = 0; i < BOARD_SIZE; i++){
         for(int j = 0; j < BOARD_SIZE; j++){
-            board[i][j] = nums[index++];
+            board[i][j] = BOARD_LAYOUT[i * BOARD_SIZE + j];
         }
     }
 }
 
 // Check if a product is available to occupy on the board
 bool isValidMove(int product){
-    for(int i = 0; i < BOARD_SIZE; i++){
-        for(int j = 0; j < BOARD_SIZE; j++){
-            if(board[i][j] == product && moveOwner[i][j] == NO_PLAYER){
-                return true;
-            }
-        }
-    }
-    return false;
+    int cell = productCell(product);
+    return cell >= 0 && !(occupiedBits() & (Bitboard(1) << cell));
 }
 
-// Temporarily marks a cell to see if it results in a win for the Computer
+// Checks whether marking the product's cell results in a win for the player
 bool wouldWin(int product, int player){
-    for(int i = 0; i < BOARD_SIZE; i++){
-        for(int j = 0; j < BOARD_SIZE; j++){
-            if(board[i][j] == product && moveOwner[i][j] == NO_PLAYER){
-                moveOwner[i][j] = player;
-                bool wins = (checkWinCondition() == player);
-                moveOwner[i][j] = NO_PLAYER;
-                return wins;
-            }
-        }
-    }
-    return false;
+    if(!isValidMove(product)) return false;
+    int cell = productCell(product);
+    return hasWinLineThrough(playerBits[player] | (Bitboard(1) << cell), cell);
 }
 
-// Marks the cell corresponding to the product for the given player
-bool markProduct(int product, int player, const BoardDisplayInfo& displayInfo){
-     for(int i = 0; i < BOARD_SIZE; i++){
-        for(int j = 0; j < BOARD_SIZE; j++){
-            if(board[i][j] == product && moveOwner[i][j] == NO_PLAYER){
-                moveOwner[i][j] = player;
-                int color = (player == HUMAN_PLAYER) ? 1 : 4; // Red for Human, Blue for Computer
-                int current_row_y = displayInfo.start_y + 1 + i * 2;
-                int cell_start_x = displayInfo.start_x + 1 + j * displayInfo.cell_width;
-                attron(A_BOLD | COLOR_PAIR(color)); // Graphical stuff
-                mvprintw(current_row_y, cell_start_x + 1, "[%c%*d]",
-                         (player == HUMAN_PLAYER ? 'H' : 'C'), displayInfo.cell_width - 4, board[i][j]);
-                attroff(A_BOLD | COLOR_PAIR(color));
-                refresh();
-                return true;
-            }
-        }
+// Sets the player's bit for a cell and retires the opponent lines it blocks:
+// those the player had no mark in yet, whatever the opponent has there
+void placeMark(int cell, int player){
+    int opponent = (player == HUMAN_PLAYER) ? COMPUTER_PLAYER : HUMAN_PLAYER;
+    const CellLines &lines = CELL_LINES[cell];
+    for(int k = 0; k < lines.count; k++){
+        Bitboard line = lines.masks[k];
+        if(!(playerBits[player] & line)) liveLines[opponent]--;
     }
-    return false;
+    playerBits[player] |= Bitboard(1) << cell;
+}
+
+// Plays a factor for the side to move through the game's move stack and shows the new mark
+bool playFactor(GameState &state, int factor, const BoardDisplayInfo& displayInfo){
+    if(!isLegalFactor(state.history.position(), factor)) return false;
+    state.lastCell = state.history.make(factor);
+    state.activeFactor = factor;
+    syncBoard(state.history.position());
+    if(displayInfo.valid) drawChangedCells(displayInfo);
+    return true;
 }
 
 // Simple evaluation for a potential computer move
 int evaluateMove(int product, int player){
     int score = 0;
-    int r = -1, c = -1;
-    for(int i = 0; i < BOARD_SIZE && r == -1; i++){
-        for(int j = 0; j < BOARD_SIZE; j++){
-            if(board[i][j] == product && moveOwner[i][j] == NO_PLAYER){
-                r = i; c = j; break;
-            }
-        }
-    }
-    if(r == -1) return std::numeric_limits<int>::min();
-    moveOwner[r][c] = player;
+    if(!isValidMove(product)) return std::numeric_limits<int>::min();
+    int r = productCell(product) / BOARD_SIZE;
+    int c = productCell(product) % BOARD_SIZE;
     for(auto &dir : directions){
         int consecutive = 0;
         int open_ends = 0;
         // Check positive direction
-        for(int k = 1; k < 4; ++k){
+        for(int k = 1; k < WIN_LENGTH; ++k){
             int nr = r + k * dir[0]; int nc = c + k * dir[1];
-            if(nr < 0 || nr >= BOARD_SIZE || nc < 0 || nc >= BOARD_SIZE) break;
-            if(moveOwner[nr][nc] == player) consecutive++;
-            else if(moveOwner[nr][nc] == NO_PLAYER) { open_ends++; break; }
+            if(nr < 0 || nr >= BOARD_SIZE || nc < 0 || nc >= BOARD_SIZE || !isPlayableCell(nr, nc)) break;
+            int owner = cellOwner(nr, nc);
+            if(owner == player) consecutive++;
+            else if(owner == NO_PLAYER) { open_ends++; break; }
             else break;
         }
         // Check negative direction
-         for(int k = 1; k < 4; ++k){
+         for(int k = 1; k < WIN_LENGTH; ++k){
             int nr = r - k * dir[0]; int nc = c - k * dir[1];
-            if(nr < 0 || nr >= BOARD_SIZE || nc < 0 || nc >= BOARD_SIZE) break;
-            if(moveOwner[nr][nc] == player) consecutive++;
-            else if(moveOwner[nr][nc] == NO_PLAYER) { open_ends++; break; }
+            if(nr < 0 || nr >= BOARD_SIZE || nc < 0 || nc >= BOARD_SIZE || !isPlayableCell(nr, nc)) break;
+            int owner = cellOwner(nr, nc);
+            if(owner == player) consecutive++;
+            else if(owner == NO_PLAYER) { open_ends++; break; }
             else break;
         }
         consecutive++;
         // Scoring
-        if(consecutive >= 4) score += score_win;
-        else if(consecutive == 3 && open_ends >= 1) score += (open_ends == 2 ? thr_tw : thr_on);
-        else if(consecutive == 2 && open_ends == 2) score += no_op;
+        if(consecutive >= WIN_LENGTH) score += score_win;
+        else if(consecutive == WIN_LENGTH - 1 && open_ends >= 1) score += (open_ends == 2 ? thr_tw : thr_on);
+        else if(consecutive == WIN_LENGTH - 2 && open_ends == 2) score += no_op;
     }
     int center_start = BOARD_SIZE / 2 - 1;
     int center_end = BOARD_SIZE / 2;
     if(r >= center_start && r <= center_end && c >= center_start && c <= center_end){
         score += 2;
     }
-    moveOwner[r][c] = NO_PLAYER;
     return score;
 }
 
-// Calculates the board display dimensions and position
+// Snapshot of the global board for the AI search
+Position currentPosition(const GameState &state){
+    Position pos;
+    clearPosition(pos, state.activeFactor, state.humanTurn ? HUMAN_PLAYER : COMPUTER_PLAYER);
+    pos.bits[HUMAN_PLAYER] = playerBits[HUMAN_PLAYER];
+    pos.bits[COMPUTER_PLAYER] = playerBits[COMPUTER_PLAYER];
+    pos.liveLines[HUMAN_PLAYER] = liveLines[HUMAN_PLAYER];
+    pos.liveLines[COMPUTER_PLAYER] = liveLines[COMPUTER_PLAYER];
+    pos.key = computeKey(pos);
+    return pos;
+}
+
+// Copies a position's marks and live lines onto the global board
+void syncBoard(const Position &pos){
+    for(int p = HUMAN_PLAYER; p <= COMPUTER_PLAYER; p++){
+        playerBits[p] = pos.bits[p];
+        liveLines[p] = pos.liveLines[p];
+    }
+}
+
+// Shows the top of the game's move stack, e.g. after an undo or redo
+void restoreFromHistory(GameState &state){
+    const Position &pos = state.history.position();
+    syncBoard(pos);
+    state.activeFactor = pos.activeFactor;
+    state.humanTurn = pos.sideToMove == HUMAN_PLAYER;
+    state.lastCell = state.history.size() ? state.history.last().cell : -1;
+}
+
+// Starts a game's history at a Position, e.g. from a save or the journal
+void loadPosition(const Position &pos, GameState &state){
+    state.history.reset(pos);
+    restoreFromHistory(state);
+}
+
+// Search panel to the right of the board (--hud)
+const int PANEL_WIDTH = 26;
+const int PANEL_GAP = 3;
+
+// Calculates the board display dimensions and position; with the search
+// panel on and room for it, the board and panel are centred together
 BoardDisplayInfo getBoardDisplayInfo() {
     BoardDisplayInfo info;
     info.cell_width = 7;
@@ -127,6 +149,9 @@ BoardDisplayInfo getBoardDisplayInfo() {
     info.required_height = 2 * BOARD_SIZE + 1;
     info.start_y = 6;
     info.start_x = (COLS - info.total_width) / 2;
+    if(gameConfig.searchPanel && info.total_width + PANEL_GAP + PANEL_WIDTH <= COLS){
+        info.start_x = (COLS - info.total_width - PANEL_GAP - PANEL_WIDTH) / 2;
+    }
     if(info.start_x < 0) info.start_x = 0;
     info.valid = true;
     if(info.start_y + info.required_height >= LINES || info.total_width >= COLS){
@@ -135,26 +160,46 @@ BoardDisplayInfo getBoardDisplayInfo() {
     return info;
 }
 
-// Displays the main game board and current game state (Graphical stuff)
-BoardDisplayInfo display_board_ncurses(const GameState &state){
-    clear();
-    BoardDisplayInfo displayInfo = getBoardDisplayInfo(); // graphical stuff
-    attron(A_BOLD | COLOR_PAIR(6));
-    mvprintw(1, (COLS - 20)/2, "MULTIPLICATION GAME"); 
-    attroff(A_BOLD | COLOR_PAIR(6));
-    attron(COLOR_PAIR(3));
-    mvprintw(3, (COLS-25)/2, "    Active Factor: %d", state.activeFactor);
-    attroff(COLOR_PAIR(3));
-    attron(A_BOLD | COLOR_PAIR(state.humanTurn ? 1 : 4));
-    mvprintw(4, (COLS-20)/2, "  %s's turn", state.humanTurn ? "Human" : "Computer");
-    attroff(A_BOLD | COLOR_PAIR(state.humanTurn ? 1 : 4));
-    if(!displayInfo.valid){
-        attron(COLOR_PAIR(1)|A_BOLD); // graphical stuff
-        mvprintw(LINES / 2, (COLS - 30) / 2, "Terminal too small to draw board!");
-        attroff(COLOR_PAIR(1)|A_BOLD);
-        refresh();
-        return displayInfo;
+namespace {
+
+// What the board screen currently shows, so a redraw only touches what changed
+struct BoardView {
+    bool inUse = false;           // a game is on screen, redraw it on KEY_RESIZE
+    bool gridDrawn = false;       // title and borders are on stdscr for `layout`
+    int lines = 0, cols = 0;      // terminal size `layout` was computed for
+    BoardDisplayInfo layout;
+    int cellShown[NUM_CELLS];     // owner drawn in each cell, -1 = not drawn yet
+    int factorShown = -1;
+    int turnShown = -1;           // 1 human, 0 computer
+    uint64_t panelShown = UINT64_MAX;  // moveMetricsVersion on the search panel
+    GameState state;              // last state drawn
+};
+
+BoardView view;
+
+void drawCell(const BoardDisplayInfo &info, int cell, int owner){
+    int i = cell / BOARD_SIZE, j = cell % BOARD_SIZE;
+    int current_row_y = info.start_y + 1 + i * 2;
+    int cell_start_x = info.start_x + 1 + j * info.cell_width;
+    if(owner != NO_PLAYER){
+        int color_pair = (owner == HUMAN_PLAYER) ? 1 : 4; // Red for Human, Blue for Computer
+        mvaddch(current_row_y, cell_start_x, ' ');
+        attron(A_BOLD | COLOR_PAIR(color_pair)); // graphical stuff
+        mvprintw(current_row_y, cell_start_x + 1, "[%c%*d]",
+                (owner == HUMAN_PLAYER) ? 'H' : 'C',
+                info.cell_width - 4,
+                board[i][j]);
+        attroff(A_BOLD | COLOR_PAIR(color_pair));
+    }else if(board[i][j] == 0){
+        mvprintw(current_row_y, cell_start_x, " %*s ", info.cell_width - 2, "--"); // blank cell left over by the factor range
+    }else{
+        mvprintw(current_row_y, cell_start_x, " %*d ", info.cell_width - 2, board[i][j]);
     }
+    mvaddch(current_row_y, info.start_x + info.cell_width + j * info.cell_width, ACS_VLINE);
+}
+
+// Borders only; the cells are filled in by drawChangedCells()
+void drawGrid(const BoardDisplayInfo &displayInfo){
     mvaddch(displayInfo.start_y, displayInfo.start_x, ACS_ULCORNER);
     for(int j = 0; j < BOARD_SIZE; j++){
         mvhline(displayInfo.start_y, displayInfo.start_x + 1 + j *  // graphical stuff
@@ -166,22 +211,6 @@ BoardDisplayInfo display_board_ncurses(const GameState &state){
         int current_row_y = displayInfo.start_y + 1 + i * 2;
         int separator_row_y = displayInfo.start_y + 2 + i * 2;
         mvaddch(current_row_y, displayInfo.start_x, ACS_VLINE);
-        for(int j = 0; j < BOARD_SIZE; j++){
-            int cell_start_x = displayInfo.start_x + 1 + j * displayInfo.cell_width;
-            if(moveOwner[i][j] != NO_PLAYER){
-                int color_pair = (moveOwner[i][j] == HUMAN_PLAYER) ? 1 : 4;
-                attron(A_BOLD | COLOR_PAIR(color_pair)); // graphical stuff
-                mvprintw(current_row_y, cell_start_x + 1, "[%c%*d]",
-                        (moveOwner[i][j] == HUMAN_PLAYER) ? 'H' : 'C',
-                        displayInfo.cell_width - 4,
-                        board[i][j]);
-                attroff(A_BOLD | COLOR_PAIR(color_pair));
-            }else{
-                mvprintw(current_row_y, cell_start_x, " %*d ", displayInfo.cell_width - 2, board[i][j]);
-            }
-            mvaddch(current_row_y, displayInfo.start_x + displayInfo.cell_width + j * 
-                displayInfo.cell_width, ACS_VLINE);
-        }
         if(i < BOARD_SIZE - 1){
             mvaddch(separator_row_y, displayInfo.start_x, ACS_LTEE); // graphical stuff
             for (int j = 0; j < BOARD_SIZE; j++){
@@ -200,6 +229,154 @@ BoardDisplayInfo display_board_ncurses(const GameState &state){
         mvaddch(bottom_border_y, displayInfo.start_x + displayInfo.cell_width + j * 
             displayInfo.cell_width, (j < BOARD_SIZE - 1) ? ACS_BTEE : ACS_LRCORNER);
     }
-    refresh();
-    return displayInfo;
-}
\ No newline at end of file
+}
+
+void drawStatus(const GameState &state){
+    int turn = state.humanTurn ? 1 : 0;
+    if(state.activeFactor == view.factorShown && turn == view.turnShown) return;
+    move(3, 0); clrtoeol();
+    move(4, 0); clrtoeol();
+    attron(COLOR_PAIR(3));
+    mvprintw(3, (COLS-25)/2, "    Active Factor: %d", state.activeFactor);
+    attroff(COLOR_PAIR(3));
+    attron(A_BOLD | COLOR_PAIR(state.humanTurn ? 1 : 4));
+    mvprintw(4, (COLS-20)/2, "  %s's turn", state.humanTurn ? "Human" : "Computer");
+    attroff(A_BOLD | COLOR_PAIR(state.humanTurn ? 1 : 4));
+    view.factorShown = state.activeFactor;
+    view.turnShown = turn;
+}
+
+const int PANEL_SCORES_PER_ROW = 2;
+
+// 1234567 -> "1.23M"
+std::string formatCount(double count){
+    const char *suffixes[] = {"", "k", "M", "G"};
+    int s = 0;
+    while(count >= 1000.0 && s < 3){ count /= 1000.0; s++; }
+    char text[16];
+    std::snprintf(text, sizeof(text), s ? "%.3g%s" : "%.0f%s", count, suffixes[s]);
+    return text;
+}
+
+// Search scores as "+46", or "W5"/"L4" for a win or a loss that many plies away
+std::string formatScore(int score){
+    if(isWinScore(score)) return (score > 0 ? "W" : "L") + std::to_string(WIN_SCORE - std::abs(score));
+    return (score > 0 ? "+" : "") + std::to_string(score);
+}
+
+// The computer's last move to the right of the board (--hud): what it cost,
+// how far it looked and what it thought of every factor. Skipped when the
+// terminal is too narrow, and redrawn only after a new computer move.
+void drawSearchPanel(const BoardDisplayInfo &info){
+    const int x = info.start_x + info.total_width + PANEL_GAP;
+    if(!gameConfig.searchPanel || x + PANEL_WIDTH > COLS || view.panelShown == moveMetricsVersion) return;
+    view.panelShown = moveMetricsVersion;
+    const int maxRows = std::min(LINES - 2 - info.start_y, 10 + (MAX_FACTOR + PANEL_SCORES_PER_ROW - 1) / PANEL_SCORES_PER_ROW);
+    for(int row = 0; row < maxRows; row++) mvprintw(info.start_y + row, x, "%*s", PANEL_WIDTH, "");
+
+    int y = info.start_y;
+    auto line = [&](const char *label, const std::string &value){
+        if(y - info.start_y >= maxRows) return;
+        mvprintw(y++, x, "%-10s%s", label, value.substr(0, PANEL_WIDTH - 10).c_str());
+    };
+    attron(A_BOLD | COLOR_PAIR(6));
+    mvprintw(y++, x, "Computer's last move");
+    attroff(A_BOLD | COLOR_PAIR(6));
+    if(moveMetricsVersion == 0){
+        line("", "none yet");
+        return;
+    }
+    const MoveMetrics &m = lastMoveMetrics;
+    char text[32];
+    line("Factor", std::to_string(m.factor) + " (" + m.source + ")");
+    std::snprintf(text, sizeof(text), "%.1f ms", m.elapsedMs);
+    line("Time", text);
+    const bool mcts = std::string(m.source) == "mcts";
+    line(mcts ? "Playouts" : "Nodes", formatCount((double)m.nodes));
+    line("Speed", formatCount(m.nodesPerSec()) + "/s");
+    line("Depth", std::to_string(m.depth));
+    std::snprintf(text, sizeof(text), "%.1f%% of %s", m.ttProbes ? 100.0 * m.ttHits / m.ttProbes : 0.0,
+                  formatCount((double)m.ttProbes).c_str());
+    line("TT hits", text);
+    if(mcts) line("Win rate", std::to_string(m.score) + "%");
+    else line("Score", m.hasScore ? formatScore(m.score) : "-");
+
+    // Scored factors two to a row, the one played in bold; "<=" marks a score
+    // that is only an upper bound because the move failed low in the search
+    int column = 0;
+    for(size_t f = 0; f < m.factorScores.size(); f++){
+        if(m.factorScores[f] == NO_FACTOR_SCORE) continue;
+        if(column == 0){
+            if(y - info.start_y >= maxRows) break;
+            y++;
+        }
+        if((int)f == m.factor) attron(A_BOLD | COLOR_PAIR(4));
+        std::string score = (m.isUpperBound(f) ? "<=" : "") + formatScore(m.factorScores[f]);
+        mvprintw(y - 1, x + column * (PANEL_WIDTH / PANEL_SCORES_PER_ROW), "%2zu:%-9s",
+                 f, score.substr(0, 9).c_str());
+        if((int)f == m.factor) attroff(A_BOLD | COLOR_PAIR(4));
+        column = (column + 1) % PANEL_SCORES_PER_ROW;
+    }
+}
+
+} // namespace
+
+// Repaints only the cells whose owner differs from what is on screen
+void drawChangedCells(const BoardDisplayInfo &displayInfo){
+    if(!view.gridDrawn) return;
+    for(int cell = 0; cell < NUM_CELLS; cell++){
+        int owner = cellOwner(cell / BOARD_SIZE, cell % BOARD_SIZE);
+        if(owner == view.cellShown[cell]) continue;
+        drawCell(displayInfo, cell, owner);
+        view.cellShown[cell] = owner;
+    }
+    wnoutrefresh(stdscr);
+    doupdate();
+}
+
+// Displays the main game board and current game state (Graphical stuff).
+// The grid is laid out once per terminal size; later calls only repaint
+// changed cells and status lines, batched into a single doupdate().
+BoardDisplayInfo display_board_ncurses(const GameState &state){
+    view.inUse = true;
+    view.state = state;
+    if(!view.gridDrawn || view.lines != LINES || view.cols != COLS){
+        erase();
+        view.layout = getBoardDisplayInfo(); // graphical stuff
+        view.lines = LINES;
+        view.cols = COLS;
+        view.factorShown = view.turnShown = -1;
+        view.panelShown = UINT64_MAX;
+        for(int &owner : view.cellShown) owner = -1;
+        attron(A_BOLD | COLOR_PAIR(6));
+        mvprintw(1, (COLS - 20)/2, "MULTIPLICATION GAME"); 
+        attroff(A_BOLD | COLOR_PAIR(6));
+        if(!view.layout.valid){
+            drawStatus(state);
+            attron(COLOR_PAIR(1)|A_BOLD); // graphical stuff
+            mvprintw(LINES / 2, (COLS - 30) / 2, "Terminal too small to draw board!");
+            attroff(COLOR_PAIR(1)|A_BOLD);
+            view.gridDrawn = false;
+            refresh();
+            return view.layout;
+        }
+        drawGrid(view.layout);
+        view.gridDrawn = true;
+    }
+    drawStatus(state);
+    drawSearchPanel(view.layout);
+    drawChangedCells(view.layout);
+    return view.layout;
+}
+
+// Lays the board out again for the new terminal size, if one is on screen
+void relayoutBoard(){
+    if(view.inUse) display_board_ncurses(view.state);
+}
+
+// Forget the screen contents; the next display_board_ncurses() draws everything
+void resetBoardView(){
+    view.inUse = false;
+    view.gridDrawn = false;
+    view.panelShown = UINT64_MAX;
+}
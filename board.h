@@ -4,9 +4,26 @@
 #include "game.h"
 #include <ncurses.h>
 #include "constants.h"
+#include "bitboard.h"
+#include "position.h"
 
 extern int board[BOARD_SIZE][BOARD_SIZE];
-extern int moveOwner[BOARD_SIZE][BOARD_SIZE];
+
+// Occupancy of the game on screen, indexed by HUMAN_PLAYER / COMPUTER_PLAYER (slot 0 unused)
+extern Bitboard playerBits[3];
+// Lines each player can still complete (no opponent mark in them)
+extern int liveLines[3];
+
+inline int cellOwner(int r, int c){
+    Bitboard bit = cellBit(r, c);
+    if(playerBits[HUMAN_PLAYER] & bit) return HUMAN_PLAYER;
+    if(playerBits[COMPUTER_PLAYER] & bit) return COMPUTER_PLAYER;
+    return NO_PLAYER;
+}
+
+inline Bitboard occupiedBits(){
+    return playerBits[HUMAN_PLAYER] | playerBits[COMPUTER_PLAYER];
+}
 
 struct BoardDisplayInfo {
     int start_y;
@@ -19,10 +36,18 @@ struct BoardDisplayInfo {
 
 void initializeBoard();
 bool isValidMove(int product);
-bool markProduct(int product, int player, const BoardDisplayInfo& displayInfo);
+void placeMark(int cell, int player);
+bool playFactor(GameState &state, int factor, const BoardDisplayInfo& displayInfo);
 bool wouldWin(int product, int player);
 int evaluateMove(int product, int player);
+Position currentPosition(const GameState &state);
+void syncBoard(const Position &pos);
+void restoreFromHistory(GameState &state);
+void loadPosition(const Position &pos, GameState &state);
 BoardDisplayInfo getBoardDisplayInfo();
 BoardDisplayInfo display_board_ncurses(const GameState &state);
+void drawChangedCells(const BoardDisplayInfo &displayInfo);
+void relayoutBoard();
+void resetBoardView();
 
 #endif
\ No newline at end of file
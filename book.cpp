@@ -0,0 +1,31 @@
+#include "book.h"
+
+namespace {
+
+const char BOOK_MAGIC[8] = {'M', 'G', 'B', 'O', 'O', 'K', '0', '1'};
+const uint64_t VALUE_MASK = 0xFFF;
+
+uint64_t packSlot(const BookEntry &entry){
+    return (entry.key & ~VALUE_MASK) | (uint64_t)(entry.depth & 0xFF) << 4 | (uint64_t)(entry.factor & 0xF);
+}
+
+} // namespace
+
+OpeningBook::OpeningBook() : table(BOOK_MAGIC, VALUE_MASK){
+}
+
+bool OpeningBook::lookup(uint64_t key, BookEntry &entry) const {
+    uint64_t slot;
+    if(!table.lookup(key, slot)) return false;
+    entry.key = key;
+    entry.factor = (int)(slot & 0xF);
+    entry.depth = (int)((slot >> 4) & 0xFF);
+    return true;
+}
+
+bool writeOpeningBook(const std::string &path, const std::vector<BookEntry> &entries){
+    std::vector<uint64_t> slots;
+    slots.reserve(entries.size());
+    for(const BookEntry &entry : entries) slots.push_back(packSlot(entry));
+    return writeSlotTable(path, BOOK_MAGIC, VALUE_MASK, slots);
+}
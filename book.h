@@ -0,0 +1,38 @@
+// book.h
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "position.h"
+#include "slottable.h"
+
+const std::string BOOK_FILENAME = "multiplication" VARIANT_TAG "_book.bin";
+
+struct BookEntry {
+    uint64_t key;        // Position::key
+    int factor;          // factor found by the search for the side to move
+    int depth;           // plies it was searched to
+};
+
+// Read-only view of an opening book written by multiplication_book: a
+// SlotTable whose slots are (key & ~0xFFF) | depth << 4 | factor
+class OpeningBook {
+public:
+    OpeningBook();
+
+    bool open(const std::string &path){ return table.open(path); }
+    void close(){ table.close(); }
+    bool isOpen() const { return table.isOpen(); }
+    uint64_t size() const { return table.size(); }
+    bool lookup(uint64_t key, BookEntry &entry) const;
+
+private:
+    SlotTable table;
+};
+
+// Writes an opening book that OpeningBook can open
+bool writeOpeningBook(const std::string &path, const std::vector<BookEntry> &entries);
+
+#endif
@@ -0,0 +1,145 @@
+// Offline opening book generator: searches every position the computer can
+// face in the first plies of a game to a fixed depth on all cores and writes
+// the chosen factors to a book the game mmaps (see book.h).
+#include "gamecore.h"
+#include "search.h"
+#include "tt.h"
+#include "book.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct BookOptions {
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    int plies = 2;                       // book positions up to this many marks into a game
+    int depth = 12;                      // fixed search depth for every position
+    int hashMb = 0;                      // transposition table per worker, 0: sized to the depth
+    std::string output = BOOK_FILENAME;
+};
+
+// Positions with the computer to move within `plies` marks of `pos`. A position
+// met again with more plies left is expanded again, but only booked once.
+void collectOpenings(Position &pos, int plies, bool afterPass,
+                     std::unordered_map<uint64_t, int> &explored, std::vector<Position> &out){
+    Bitboard legal = legalMoves(pos);
+    if(!legal){
+        if(afterPass) return;
+        makePass(pos);
+        collectOpenings(pos, plies, true, explored, out);
+        makePass(pos);
+        return;
+    }
+    if(isDead(pos)) return;
+    auto it = explored.find(pos.key);
+    if(it != explored.end() && it->second >= plies) return;
+    if(it == explored.end()){
+        if(pos.sideToMove == COMPUTER_PLAYER) out.push_back(pos);
+        explored.emplace(pos.key, plies);
+    }else{
+        it->second = plies;
+    }
+    if(plies == 0) return;
+    const int previousFactor = pos.activeFactor;
+    for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+        int cell = MOVE_CELL[previousFactor][f];
+        if(!(legal & (Bitboard(1) << cell))) continue;
+        makeMove(pos, f);
+        if(!wonAt(pos, cell, opponentOf(pos.sideToMove))) collectOpenings(pos, plies - 1, false, explored, out);
+        unmakeMove(pos, cell, previousFactor);
+    }
+}
+
+// Each position clears its table, so one much larger than the search fills
+// costs more to clear than the search itself: 1 MB up to depth 8, doubling
+// per ply after that, which measured fastest at the default depth of 12
+int tableMbForDepth(int depth){
+    return 1 << std::min(std::max(depth - 8, 0), 6);
+}
+
+bool parseOptions(int argc, char **argv, BookOptions &options){
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(i + 1 >= argc) return false;
+        const char *value = argv[++i];
+        if(arg == "--threads") options.threads = std::atoi(value);
+        else if(arg == "--plies") options.plies = std::atoi(value);
+        else if(arg == "--depth") options.depth = std::atoi(value);
+        else if(arg == "--hash") options.hashMb = std::atoi(value);
+        else if(arg == "--output") options.output = value;
+        else return false;
+    }
+    return options.threads > 0 && options.plies >= 0 && options.depth > 0
+        && options.depth <= std::min(MAX_SEARCH_DEPTH, 255) && options.hashMb >= 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv){
+    BookOptions options;
+    if(!parseOptions(argc, argv, options)){
+        std::fprintf(stderr, "Usage: %s [--threads n] [--plies n] [--depth n] [--hash MB] [--output file]\n", argv[0]);
+        return 1;
+    }
+    if(options.hashMb == 0) options.hashMb = tableMbForDepth(options.depth);
+
+    // Every game starts from one of these 18 situations
+    std::vector<Position> openings;
+    std::unordered_map<uint64_t, int> explored;
+    for(int factor = MIN_FACTOR; factor <= MAX_FACTOR; factor++){
+        for(int side = HUMAN_PLAYER; side <= COMPUTER_PLAYER; side++){
+            Position pos;
+            clearPosition(pos, factor, side);
+            collectOpenings(pos, options.plies, false, explored, openings);
+        }
+    }
+    std::printf("Searching %zu opening positions to depth %d on %d threads with %d MB tables\n",
+                openings.size(), options.depth, options.threads, options.hashMb);
+    std::fflush(stdout);
+
+    // Each position gets a cleared table so the book is the same on any number of threads
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<BookEntry> entries(openings.size());
+    std::atomic<size_t> nextOpening(0);
+    std::atomic<size_t> done(0);
+    std::mutex progressMutex;
+    std::vector<std::thread> workers;
+    for(int t = 0; t < options.threads; t++){
+        workers.emplace_back([&](){
+            TranspositionTable table(options.hashMb);
+            for(size_t i = nextOpening++; i < openings.size(); i = nextOpening++){
+                table.clear();
+                SearchLimits limits;
+                limits.timeMs = INT_MAX;
+                limits.maxDepth = options.depth;
+                limits.table = &table;
+                SearchResult result = searchBestFactor(openings[i], limits);
+                entries[i] = {openings[i].key, result.factor, result.depth};
+                size_t finished = ++done;
+                if(finished % std::max<size_t>(1, openings.size() / 20) == 0){
+                    std::lock_guard<std::mutex> lock(progressMutex);
+                    std::printf("  %zu/%zu positions\n", finished, openings.size());
+                    std::fflush(stdout);
+                }
+            }
+        });
+    }
+    for(auto &worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    if(!writeOpeningBook(options.output, entries)){
+        std::fprintf(stderr, "Could not write %s\n", options.output.c_str());
+        return 1;
+    }
+    std::printf("Booked %zu positions in %.1f s, written to %s\n", entries.size(), seconds, options.output.c_str());
+    return 0;
+}
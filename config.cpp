@@ -0,0 +1,83 @@
+#include "config.h"
+#include <cstdio>
+#include <cstdlib>
+
+GameConfig gameConfig;
+
+namespace {
+
+// Parses a positive integer option value in [minValue, maxValue]
+bool parseIntValue(const char *text, int minValue, int maxValue, int &value){
+    char *end = nullptr;
+    long parsed = std::strtol(text, &end, 10);
+    if(end == text || *end != '\0' || parsed < minValue || parsed > maxValue) return false;
+    value = (int)parsed;
+    return true;
+}
+
+} // namespace
+
+bool parseCommandLine(int argc, char **argv, GameConfig &config, std::string &error){
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        int *target = nullptr;
+        int minValue = 1, maxValue = 1;
+        if(arg == "--hash"){ target = &config.hashMb; maxValue = 65536; }
+        else if(arg == "--think-ms"){ target = &config.thinkMs; maxValue = 600000; }
+        else if(arg == "--depth"){ target = &config.maxDepth; maxValue = MAX_SEARCH_DEPTH; }
+        else if(arg == "--threads"){ target = &config.threads; maxValue = MAX_SEARCH_THREADS; }
+        else if(arg == "--mcts-nodes"){ target = &config.mctsNodes; minValue = 1024; maxValue = 1 << 28; }
+        else if(arg == "--engine"){
+            if(i + 1 >= argc){ error = "Missing value for " + arg; return false; }
+            std::string name = argv[++i];
+            if(name == "alphabeta") config.engine = ENGINE_ALPHABETA;
+            else if(name == "mcts") config.engine = ENGINE_MCTS;
+            else if(name == "greedy") config.engine = ENGINE_GREEDY;
+            else { error = "Invalid value for " + arg + ": " + name; return false; }
+            continue;
+        }
+        else if(arg == "--solved-db"){
+            if(i + 1 >= argc){ error = "Missing value for " + arg; return false; }
+            config.solvedDbPath = argv[++i];
+            continue;
+        }
+        else if(arg == "--book"){
+            if(i + 1 >= argc){ error = "Missing value for " + arg; return false; }
+            config.bookPath = argv[++i];
+            continue;
+        }
+        else if(arg == "--metrics"){
+            if(i + 1 >= argc){ error = "Missing value for " + arg; return false; }
+            config.metricsPath = argv[++i];
+            continue;
+        }
+        else if(arg == "--fast"){ config.fastMode = true; continue; }
+        else if(arg == "--hud"){ config.searchPanel = true; continue; }
+        else if(arg == "--ponder"){ config.ponder = true; continue; }
+        else if(arg == "--help" || arg == "-h"){ error = ""; return false; }
+        else { error = "Unknown option: " + arg; return false; }
+
+        if(i + 1 >= argc){ error = "Missing value for " + arg; return false; }
+        if(!parseIntValue(argv[++i], minValue, maxValue, *target)){
+            error = "Invalid value for " + arg + ": " + argv[i];
+            return false;
+        }
+    }
+    return true;
+}
+
+void printUsage(const char *program){
+    std::printf("Usage: %s [options]\n", program);
+    std::printf("  --hash <MB>        transposition table size (default %d)\n", DEFAULT_HASH_MB);
+    std::printf("  --think-ms <ms>    computer thinking time per move (default %d)\n", DEFAULT_THINK_MS);
+    std::printf("  --depth <plies>    cap the computer's search depth (default %d)\n", MAX_SEARCH_DEPTH);
+    std::printf("  --threads <n>      search threads for the computer (default 1)\n");
+    std::printf("  --solved-db <file> solved-position database (default %s)\n", SOLVED_DB_FILENAME.c_str());
+    std::printf("  --book <file>      opening book for alphabeta (default %s)\n", BOOK_FILENAME.c_str());
+    std::printf("  --ponder           think about the replies while it is your turn\n");
+    std::printf("  --fast             no pauses between turns, messages never hold up play\n");
+    std::printf("  --engine <name>    alphabeta, mcts or greedy (default alphabeta)\n");
+    std::printf("  --mcts-nodes <n>   MCTS tree size in nodes (default %d)\n", (int)DEFAULT_MCTS_NODES);
+    std::printf("  --hud              show the computer's search statistics next to the board\n");
+    std::printf("  --metrics <file>   append the statistics of every computer move as JSON lines\n");
+}
@@ -0,0 +1,35 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include "search.h"
+#include "solvedb.h"
+#include "book.h"
+#include "mcts.h"
+
+// Which algorithm picks the computer's factor
+enum EngineKind { ENGINE_ALPHABETA, ENGINE_MCTS, ENGINE_GREEDY };
+
+// Engine settings chosen on the command line
+struct GameConfig {
+    EngineKind engine = ENGINE_ALPHABETA;
+    int hashMb = DEFAULT_HASH_MB;
+    int thinkMs = DEFAULT_THINK_MS;
+    int maxDepth = MAX_SEARCH_DEPTH;                 // alpha-beta depth cap, the time budget still applies
+    int threads = 1;
+    std::string solvedDbPath = SOLVED_DB_FILENAME;  // used only if the file exists
+    std::string bookPath = BOOK_FILENAME;            // opening book for alphabeta, used only if the file exists
+    bool ponder = false;                             // search the replies while the human thinks
+    bool fastMode = false;                           // no pacing pauses, only compute and drawing
+    int mctsNodes = (int)DEFAULT_MCTS_NODES;         // MCTS arena size in nodes
+    bool searchPanel = false;                        // show the last move's search statistics by the board
+    std::string metricsPath;                         // JSON lines of every computer move, none if empty
+};
+
+extern GameConfig gameConfig;
+
+// Returns false and fills `error` on an unknown option or a bad value
+bool parseCommandLine(int argc, char **argv, GameConfig &config, std::string &error);
+void printUsage(const char *program);
+
+#endif
@@ -2,6 +2,52 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
-const int BOARD_SIZE = 6;
+// The board variant is fixed at compile time so every table and loop bound
+// is a constant; `make variant-<name>` builds the others into build/<name>.
+#ifndef MG_BOARD_SIZE
+#define MG_BOARD_SIZE 6
+#endif
+#ifndef MG_WIN_LENGTH
+#define MG_WIN_LENGTH 4
+#endif
+#ifndef MG_MAX_FACTOR
+#define MG_MAX_FACTOR 9
+#endif
+
+// Appended to data file names so variants never read each other's saves
+#ifdef MG_VARIANT
+#define MG_STRINGIFY(x) #x
+#define MG_VARIANT_NAME(x) MG_STRINGIFY(x)
+#define VARIANT_TAG "_" MG_VARIANT_NAME(MG_VARIANT)
+#else
+#define VARIANT_TAG ""
+#endif
+
+const int BOARD_SIZE = MG_BOARD_SIZE;
+const int WIN_LENGTH = MG_WIN_LENGTH;
+const int HUMAN_PLAYER = 1;
+const int COMPUTER_PLAYER = 2;
+const int NO_PLAYER = 0;
+const int DRAW_RESULT = 3;
+const int MIN_FACTOR = 1;
+const int MAX_FACTOR = MG_MAX_FACTOR;
+const int MAX_PRODUCT = MAX_FACTOR * MAX_FACTOR;
+
+// Distinct products of two factors; one board cell each, any cells left over stay blank
+constexpr int countDistinctProducts(){
+    bool seen[MAX_PRODUCT + 1] = {};
+    int count = 0;
+    for(int a = MIN_FACTOR; a <= MAX_FACTOR; a++){
+        for(int b = a; b <= MAX_FACTOR; b++){
+            if(!seen[a * b]) count++;
+            seen[a * b] = true;
+        }
+    }
+    return count;
+}
+
+static_assert(WIN_LENGTH >= 2 && WIN_LENGTH <= BOARD_SIZE, "a winning line has to fit on the board");
+static_assert(countDistinctProducts() <= BOARD_SIZE * BOARD_SIZE, "the factor range has more products than the board has cells");
+static_assert(MAX_FACTOR <= 15, "factors are stored in 4 bits by the transposition table and solved database");
 
 #endif
@@ -1,6 +1,8 @@
 #include "game.h"
 #include "board.h"
 #include "utils.h"
+#include "movegen.h"
+#include "journal.h"
 #include <cstdlib>
 #include <ctime>
 #include <string>
@@ -16,26 +18,22 @@ const int directions[4][2] = {
 
 // Check if the current player has at least one valid move available
 bool canPlayerMove(int currentActiveFactor){
-     for(int factor = 1; factor <= 9; factor++){
-        if(isValidMove(factor * currentActiveFactor)){
-            return true;
-        }
-    }
-    return false;
+    return legalMoves(currentActiveFactor, occupiedBits()) != 0;
 }
 
 void initializeGameState(GameState &state) {
-    state.activeFactor = 1 + rand() % 9;
+    state.activeFactor = MIN_FACTOR + rand() % MAX_FACTOR;
     state.humanTurn = (rand() % 2 == 0);
 }
 
 bool checkLine(int start_r, int start_c, int dr, int dc, int player){
+    const Bitboard owned = playerBits[player];
     int count = 0;
     // Check positive direction
     for(int k = 0; k < WIN_LENGTH; k++){
         int r = start_r + k * dr;
         int c = start_c + k * dc;
-        if(r < 0 || r >= BOARD_SIZE || c < 0 || c >= BOARD_SIZE || moveOwner[r][c] != player){
+        if(r < 0 || r >= BOARD_SIZE || c < 0 || c >= BOARD_SIZE || !(owned & cellBit(r, c))){
             break;
         }
         count++;
@@ -44,7 +42,7 @@ bool checkLine(int start_r, int start_c, int dr, int dc, int player){
     for(int k = 1; k < WIN_LENGTH; k++){
         int r = start_r - k * dr;
         int c = start_c - k * dc;
-        if(r < 0 || r >= BOARD_SIZE || c < 0 || c >= BOARD_SIZE || moveOwner[r][c] != player){
+        if(r < 0 || r >= BOARD_SIZE || c < 0 || c >= BOARD_SIZE || !(owned & cellBit(r, c))){
             break;
         }
         count++;
@@ -52,22 +50,64 @@ bool checkLine(int start_r, int start_c, int dr, int dc, int player){
     return count >= WIN_LENGTH;
 }
 
-// Check if a player has won (4 in a row horizontally, vertically, or diagonally)
+// Check if a player has won (WIN_LENGTH in a row horizontally, vertically, or diagonally)
 int checkWinCondition(){
-    for(int i = 0; i < BOARD_SIZE; i++){
-        for(int j = 0; j < BOARD_SIZE; j++){
-            int owner = moveOwner[i][j];
-            if(owner == NO_PLAYER) continue;
-            for(auto& dir: directions){
-                if(checkLine(i, j, dir[0], dir[1], owner)){
-                    return owner;
-                }
-            }
-        }
+    for(Bitboard line : WIN_LINES){
+        if((playerBits[HUMAN_PLAYER] & line) == line) return HUMAN_PLAYER;
+        if((playerBits[COMPUTER_PLAYER] & line) == line) return COMPUTER_PLAYER;
     }
     return NO_PLAYER;
 }
 
+// Only the lines through the last marked cell can have been completed by it
+int checkWinAt(int cell){
+    if(cell < 0) return NO_PLAYER;
+    Bitboard bit = Bitboard(1) << cell;
+    int owner = (playerBits[HUMAN_PLAYER] & bit) ? HUMAN_PLAYER
+              : (playerBits[COMPUTER_PLAYER] & bit) ? COMPUTER_PLAYER : NO_PLAYER;
+    if(owner != NO_PLAYER && hasWinLineThrough(playerBits[owner], cell)) return owner;
+    return NO_PLAYER;
+}
+
+// Neither player has a line left without an opponent mark in it
+bool isDeadPosition(){
+    return liveLines[HUMAN_PLAYER] == 0 && liveLines[COMPUTER_PLAYER] == 0;
+}
+
+namespace {
+
+// Takes back plies until the human's last move is undone and it is their turn again
+bool undoTurn(GameState &state){
+    MoveStack &history = state.history;
+    int keep = history.size();
+    while(keep > 0 && (history.at(keep - 1).previousSide != HUMAN_PLAYER || history.at(keep - 1).cell < 0)) keep--;
+    if(keep == 0) return false;
+    int undone = 0;
+    while(history.size() >= keep){
+        history.undo();
+        undone++;
+    }
+    gameJournal.undo(undone);
+    restoreFromHistory(state);
+    return true;
+}
+
+// Replays undone plies, the computer's reply and any pass included, up to the human's next move
+bool redoTurn(GameState &state){
+    MoveStack &history = state.history;
+    if(!history.canRedo()) return false;
+    do{
+        history.redo();
+        const MoveEntry &entry = history.last();
+        if(entry.cell < 0) gameJournal.pass(entry.previousSide, history.position());
+        else gameJournal.move(entry.previousSide, entry.factor, entry.cell, history.position());
+    }while(history.canRedo() && (history.position().sideToMove != HUMAN_PLAYER || !legalMoves(history.position())));
+    restoreFromHistory(state);
+    return true;
+}
+
+} // namespace
+
 bool humanMove(GameState &state, const BoardDisplayInfo& displayInfo){
     int input_win_height = 9, input_win_width = 70;
     int input_win_y = LINES - input_win_height - 1;
@@ -77,6 +117,7 @@ bool humanMove(GameState &state, const BoardDisplayInfo& displayInfo){
     int factor = -1;
     std::string error_msg = "";
     std::string input_str = "";
+    startPondering(state);
 
     while(true){
         werase(input_win); 
@@ -85,7 +126,7 @@ bool humanMove(GameState &state, const BoardDisplayInfo& displayInfo){
         // Display instructions
         wattron(input_win, COLOR_PAIR(3));
         mvwprintw(input_win, 1, 2, "Active Factor: %d", state.activeFactor);
-        mvwprintw(input_win, 2, 2, "Press any number [1 - 9] to move, 'q' to exit, or 's' to save.");
+        mvwprintw(input_win, 2, 2, "Press [%d - %d] to move, 'u' undo, 'r' redo, 's' save, 'q' exit.", MIN_FACTOR, MAX_FACTOR);
         wattroff(input_win, COLOR_PAIR(3));
 
         // Display error message (if any)
@@ -114,19 +155,32 @@ bool humanMove(GameState &state, const BoardDisplayInfo& displayInfo){
 
         // Read input character by character
         int ch;
-        while((ch = wgetch(input_win)) != '\n' && ch != KEY_ENTER){
+        while((ch = waitForKey(input_win)) != '\n' && ch != KEY_ENTER){
             if(ch == 'q' || ch == 'Q'){
+                stopPondering();
                 destroy_win(input_win); 
                 curs_set(0); 
                 noecho();
                 return false; // Exit the game
             }
+            if(ch == 'u' || ch == 'U' || ch == 'r' || ch == 'R'){
+                // Undo/redo a whole turn; the prompt is redrawn for the restored position
+                stopPondering();
+                bool undo = (ch == 'u' || ch == 'U');
+                if(undo ? undoTurn(state) : redoTurn(state)) display_board_ncurses(state);
+                else error_msg = undo ? "Nothing to undo." : "Nothing to redo.";
+                startPondering(state);
+                break;
+            }
             if(ch == 's' || ch == 'S'){
-                // Save the game
-                if(saveGame(state)){
-                    showTempMessage("Game Saved!", COLOR_PAIR(2) | A_BOLD, 3, 20, 1500);
+                // Save the game; pondering restarts afterwards
+                stopPondering();
+                bool saved = saveGame(state);
+                startPondering(state);
+                if(saved){
+                    showTempMessage("Game Saved to slot " + std::to_string(state.saveSlot + 1) + "!", COLOR_PAIR(2) | A_BOLD, 1500);
                 } else {
-                    showTempMessage("Save Failed!", COLOR_PAIR(1) | A_BOLD, 3, 20, 1500);
+                    showTempMessage("Save Failed!", COLOR_PAIR(1) | A_BOLD, 1500);
                 }
 
                 // Refresh the input window after saving
@@ -137,7 +191,7 @@ bool humanMove(GameState &state, const BoardDisplayInfo& displayInfo){
                 // Redraw the instructions and refresh the window
                 wattron(input_win, COLOR_PAIR(3));
                 mvwprintw(input_win, 1, 2, "Active Factor: %d", state.activeFactor);
-                mvwprintw(input_win, 2, 2, "Press any number to move, 'q' to exit, or 's' to save.");
+                mvwprintw(input_win, 2, 2, "Press [%d - %d] to move, 'u' undo, 'r' redo, 's' save, 'q' exit.", MIN_FACTOR, MAX_FACTOR);
                 wattroff(input_win, COLOR_PAIR(3));
 
                 wattron(input_win, COLOR_PAIR(7));
@@ -179,6 +233,7 @@ bool humanMove(GameState &state, const BoardDisplayInfo& displayInfo){
         // Disable input mode and hide the cursor
         noecho(); 
         curs_set(0);
+        if(ch != '\n' && ch != KEY_ENTER) continue; // undo or redo: prompt again
 
         // Validate the input
         if(input_str.empty()){
@@ -196,8 +251,8 @@ bool humanMove(GameState &state, const BoardDisplayInfo& displayInfo){
             continue;
         }
 
-        if(factor < 1 || factor > 9){
-            error_msg = "Invalid factor! Must be between 1 and 9.";
+        if(!isFactor(factor)){
+            error_msg = "Invalid factor! Must be between " + std::to_string(MIN_FACTOR) + " and " + std::to_string(MAX_FACTOR) + ".";
             continue;
         }else{
             int product = factor * state.activeFactor;
@@ -207,8 +262,8 @@ bool humanMove(GameState &state, const BoardDisplayInfo& displayInfo){
                             ") is not available!";
                 continue;
             }else{
-                if(markProduct(product, HUMAN_PLAYER, displayInfo)){
-                    state.activeFactor = factor;
+                stopPondering();
+                if(playFactor(state, factor, displayInfo)){
                     destroy_win(input_win);
                     return true;
                 }else{
@@ -223,18 +278,21 @@ bool humanMove(GameState &state, const BoardDisplayInfo& displayInfo){
 
 // Handles the computer player's move
 void computerMove(GameState &state, const BoardDisplayInfo& displayInfo){
-    showTempMessage("Computer is thinking...", COLOR_PAIR(4) | A_BOLD, 3, 30, 800 + rand() % 700);
-    // Get AI move
+    // The search budget replaces the old artificial "thinking" delay; a fast
+    // reply is still paced so the move can be followed, unless --fast
+    auto start = std::chrono::steady_clock::now();
+    WINDOW *thinking_win = showMessageWindow("Computer is thinking...", COLOR_PAIR(4) | A_BOLD, 3, 30);
     int factor = computerChooseFactor(state);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    pauseUi(COMPUTER_MIN_TURN_MS - (int)elapsed.count());
+    destroy_win(thinking_win);
     if(factor == -1){
-        showTempMessage("No valid moves - Computer passes", COLOR_PAIR(3), 3, 40, 1500);
+        showTempMessage("No valid moves - Computer passes", COLOR_PAIR(3), 1500);
     }else{
         int product = factor * state.activeFactor;
         std::string comp_choice_msg = "Computer chose factor " + std::to_string(factor) + ", marking " + std::to_string(product);
-        showTempMessage(comp_choice_msg, COLOR_PAIR(4), 3, comp_choice_msg.length() + 4, 1000);
-        if(markProduct(product, COMPUTER_PLAYER, displayInfo)){
-            state.activeFactor = factor;
-        }
+        showTempMessage(comp_choice_msg, COLOR_PAIR(4), 2500);
+        playFactor(state, factor, displayInfo);
     }
 }
 
@@ -245,9 +303,11 @@ void showGameOverMessage(int winner, bool userQuit){
     if(userQuit){
         message = ">>> GAME EXITED <<<"; detail = "(Returned to Main Menu)"; color_pair = 3;
     }else if(winner == HUMAN_PLAYER){
-        message = ">>> HUMAN WINS! <<<"; detail = "(You got 4 in a row)"; color_pair = 2;
+        message = ">>> HUMAN WINS! <<<"; detail = "(You got " + std::to_string(WIN_LENGTH) + " in a row)"; color_pair = 2;
     }else if(winner == COMPUTER_PLAYER){
-        message = ">>> COMPUTER WINS! <<<"; detail = "(Computer got 4 in a row)"; color_pair = 1;
+        message = ">>> COMPUTER WINS! <<<"; detail = "(Computer got " + std::to_string(WIN_LENGTH) + " in a row)"; color_pair = 1;
+    }else if(isDeadPosition()){
+        message = ">>> DRAW! <<<"; detail = "(No " + std::to_string(WIN_LENGTH) + " in a row is possible)"; color_pair = 3;
     }else{
         message = ">>> DRAW! <<<"; detail = "(Neither player can move)"; color_pair = 3;
     }
@@ -270,7 +330,7 @@ void showGameOverMessage(int winner, bool userQuit){
     mvwprintw(win, 5, (win_width - prompt_len) / 2, "Press any key to continue");
     wattroff(win, COLOR_PAIR(3));
     wrefresh(win);
-    flushinp(); wgetch(win);
+    flushinp(); waitForKey(win);
     destroy_win(win);
 }
 
@@ -278,7 +338,11 @@ void playGame(GameState &state, bool loaded) {
     if (!loaded) {
         resetGameMarkings();
         initializeGameState(state);
+        state.history.reset(currentPosition(state));
     }
+    resetBoardView();
+    // A recovered game keeps appending to the journal it was read from
+    if (!gameJournal.isOpen()) gameJournal.begin(JOURNAL_FILENAME, currentPosition(state));
 
     int winner = NO_PLAYER;
     bool userQuit = false;
@@ -287,48 +351,24 @@ void playGame(GameState &state, bool loaded) {
     while (winner == NO_PLAYER) {
         displayInfo = display_board_ncurses(state);
 
-        if (state.humanTurn) {
-            int prompt_h = 3, prompt_w = 55;
-            int prompt_y = LINES - prompt_h - 1, prompt_x = (COLS - prompt_w) / 2;
-            WINDOW *prompt_win = create_newwin(prompt_h, prompt_w, prompt_y, prompt_x);
-            wattron(prompt_win, COLOR_PAIR(3));
-            mvwprintw(prompt_win, 1, 2, "Your turn. Press 's' to SAVE, any other key to MOVE.");
-            wattroff(prompt_win, COLOR_PAIR(3));
-            wrefresh(prompt_win);
-
-            nodelay(stdscr, TRUE);
-            timeout(2500);
-            int ch = getch();
-            timeout(-1);
-            nodelay(stdscr, FALSE);
-
-            destroy_win(prompt_win);
-            flushinp();
-
-            if (ch == 's' || ch == 'S') {
-                if (saveGame(state)) {
-                    showTempMessage("Game Saved!", COLOR_PAIR(2) | A_BOLD, 3, 20, 1500);
-                } else {
-                    showTempMessage("Save Failed!", COLOR_PAIR(1) | A_BOLD, 3, 20, 1500);
-                }
-                displayInfo = display_board_ncurses(state);
-                if (!displayInfo.valid) return;
-            }
-        }
-
         bool currentPlayerCanMove = canPlayerMove(state.activeFactor);
         if (!currentPlayerCanMove) {
             std::string pass = (state.humanTurn ? "Human" : "Computer");
             pass += " has no valid moves. Passing turn.";
-            showTempMessage(pass, COLOR_PAIR(3), 3, pass.length() + 4, 2000);
+            showTempMessage(pass, COLOR_PAIR(3), 2000);
+            const int passer = state.humanTurn ? HUMAN_PLAYER : COMPUTER_PLAYER;
             state.humanTurn = !state.humanTurn;
+            state.history.pass();
+            gameJournal.pass(passer, state.history.position());
             bool opponentCanMove = canPlayerMove(state.activeFactor);
             if (!opponentCanMove) {
-                winner = 3;
+                winner = DRAW_RESULT;
                 break;
             } else continue;
         }
 
+        state.lastCell = -1;
+        const int mover = state.humanTurn ? HUMAN_PLAYER : COMPUTER_PLAYER;
         if (state.humanTurn) {
             if (!humanMove(state, displayInfo)) {
                 userQuit = true;
@@ -337,17 +377,101 @@ void playGame(GameState &state, bool loaded) {
         } else {
             computerMove(state, displayInfo);
         }
+        if (state.lastCell >= 0) gameJournal.move(mover, state.activeFactor, state.lastCell, state.history.position());
 
-        winner = checkWinCondition();
+        winner = checkWinAt(state.lastCell);
+        if (winner == NO_PLAYER && isDeadPosition()) {
+            winner = DRAW_RESULT;
+            break;
+        }
         if (winner == NO_PLAYER) {
             state.humanTurn = !state.humanTurn;
         }
     }
 
-    if (winner != 3 && !userQuit) {
+    if (winner != DRAW_RESULT && !userQuit) {
         display_board_ncurses(state);
     }
+    gameJournal.end(userQuit ? NO_PLAYER : winner);
     showGameOverMessage(winner, userQuit);
+    dismissToasts();
+    resetBoardView();
+    clear();
+    refresh();
+}
+
+// Steps through the last journalled game; every jump is served from the nearest snapshot
+void showReplay(){
+    JournalReplay journal;
+    if (!journal.load(JOURNAL_FILENAME)) {
+        showTempMessage("No game to replay yet.", COLOR_PAIR(1) | A_BOLD, 2000);
+        pauseUi(2000);
+        dismissToasts();
+        return;
+    }
+    const int plies = journal.plies();
+    std::string outcome = "unfinished";
+    if (journal.finished()) {
+        switch (journal.result()) {
+            case HUMAN_PLAYER: outcome = "Human won"; break;
+            case COMPUTER_PLAYER: outcome = "Computer won"; break;
+            case DRAW_RESULT: outcome = "draw"; break;
+            default: outcome = "abandoned"; break;
+        }
+    }
+
+    int info_win_height = 7, info_win_width = 70;
+    WINDOW *info_win = create_newwin(info_win_height, info_win_width, LINES - info_win_height - 1,
+                                     (COLS - info_win_width) / 2);
+    keypad(info_win, TRUE);
+    resetBoardView();
+    int ply = plies;
+    std::string target = "";
+    while (true) {
+        GameState view;
+        loadPosition(journal.positionAt(ply), view);
+        std::string described = "Starting position";
+        if (ply > 0) {
+            const JournalPly &last = journal.ply(ply);
+            view.lastCell = last.cell;
+            described = last.player == HUMAN_PLAYER ? "Human" : "Computer";
+            if (last.event == JOURNAL_PASS) described += " passed";
+            else described += " chose factor " + std::to_string(last.factor) + ", marking cell " +
+                               std::to_string(last.cell / BOARD_SIZE + 1) + "," + std::to_string(last.cell % BOARD_SIZE + 1);
+        }
+        display_board_ncurses(view);
+
+        werase(info_win);
+        box(info_win, 0, 0);
+        wattron(info_win, A_BOLD | COLOR_PAIR(6));
+        mvwprintw(info_win, 1, 2, "Replay: move %d of %d (%s)", ply, plies, outcome.c_str());
+        wattroff(info_win, A_BOLD | COLOR_PAIR(6));
+        wattron(info_win, COLOR_PAIR(7));
+        mvwprintw(info_win, 2, 2, "%s", described.c_str());
+        wattroff(info_win, COLOR_PAIR(7));
+        wattron(info_win, COLOR_PAIR(3));
+        mvwprintw(info_win, 4, 2, "Left/Right: step  Home/End: first/last  q: back");
+        mvwprintw(info_win, 5, 2, "Type a move number and Enter to jump: %s", target.c_str());
+        wattroff(info_win, COLOR_PAIR(3));
+        wrefresh(info_win);
+
+        int ch = waitForKey(info_win);
+        if (ch == 'q' || ch == 'Q' || ch == 27) break;
+        if (ch == KEY_LEFT || ch == 'h') ply = std::max(0, ply - 1);
+        else if (ch == KEY_RIGHT || ch == 'l') ply = std::min(plies, ply + 1);
+        else if (ch == KEY_HOME) ply = 0;
+        else if (ch == KEY_END) ply = plies;
+        else if (isdigit(ch) && target.length() < 3) target += (char)ch;
+        else if ((ch == KEY_BACKSPACE || ch == 127) && !target.empty()) target.pop_back();
+        else if ((ch == '\n' || ch == KEY_ENTER) && !target.empty()) {
+            ply = std::min(plies, std::stoi(target));
+            target = "";
+        }
+    }
+    destroy_win(info_win);
+    dismissToasts();
+    resetBoardView();
+    resetGameMarkings();
     clear();
     refresh();
 }
@@ -18,32 +18,38 @@
 #include "menu.h"
 #include <ncurses.h>
 #include "constants.h"
+#include "bitboard.h"
+#include "movestack.h"
 
-const std::string SAVE_FILENAME = "multiplication_save.txt";
-const int HUMAN_PLAYER = 1;
-const int COMPUTER_PLAYER = 2;
-const int NO_PLAYER = 0;
-const int WIN_LENGTH = 4;
+const std::string SAVE_FILENAME = "multiplication" VARIANT_TAG "_save.txt";
 const int score_win = 10000;
 const int thr_tw = 500;
 const int thr_on = 100;
 const int no_op = 50;
+// Shortest computer turn outside --fast, so its move can be followed on screen
+const int COMPUTER_MIN_TURN_MS = 600;
 
 extern const int directions[4][2]; // Declare as extern for global access
 extern int board[BOARD_SIZE][BOARD_SIZE];
-extern int moveOwner[BOARD_SIZE][BOARD_SIZE];
 struct BoardDisplayInfo;
 struct GameState {
     int activeFactor;
     bool humanTurn;
+    int lastCell = -1; // cell marked by the most recent move, -1 after a pass
+    int saveSlot = -1; // slot this game was loaded from or last saved to, -1 if none yet
+    MoveStack history; // every ply since the game started or was loaded; backs undo/redo
 };
 void initializeGameState(GameState &state);
 void playGame(GameState &state, bool loaded);
 bool canPlayerMove(int currentActiveFactor);
 bool checkLine(int start_r, int start_c, int dr, int dc, int player);
 int checkWinCondition();
+int checkWinAt(int cell);
+bool isDeadPosition();
 bool humanMove(GameState &state, const BoardDisplayInfo& displayInfo);
 void computerMove(GameState &state, const BoardDisplayInfo& displayInfo);
 void showGameOverMessage(int winner, bool userQuit = false);
+// Replay viewer for the game in the move journal
+void showReplay();
 
 #endif
\ No newline at end of file
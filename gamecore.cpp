@@ -0,0 +1,92 @@
+#include "gamecore.h"
+#include "search.h"
+#include "savefile.h"
+#include <fstream>
+#include <iterator>
+
+Game::Game(int firstFactor, int firstSide){
+    clearPosition(pos, firstFactor, firstSide);
+    settle();
+}
+
+Game::Game(const Position &start) : pos(start) {
+    pos.key = computeKey(pos);
+    if(hasWinLine(pos.bits[HUMAN_PLAYER])) outcome = HUMAN_PLAYER;
+    else if(hasWinLine(pos.bits[COMPUTER_PLAYER])) outcome = COMPUTER_PLAYER;
+    else settle();
+}
+
+bool Game::play(int factor){
+    if(!isLegal(factor)) return false;
+    const int side = pos.sideToMove;
+    last = makeMove(pos, factor);
+    moveCount++;
+    if(wonAt(pos, last, side)) outcome = side;
+    else settle();
+    return true;
+}
+
+// Ends dead games, passes for a stuck player, and draws when both are stuck
+void Game::settle(){
+    if(isDead(pos)){
+        outcome = DRAW_RESULT;
+        dead = true;
+        return;
+    }
+    if(::legalMoves(pos)) return;
+    makePass(pos);
+    passCount++;
+    if(!::legalMoves(pos)) outcome = DRAW_RESULT;
+}
+
+int randomFactor(const Position &pos, uint64_t &rng){
+    const Bitboard legal = legalMoves(pos);
+    if(!legal) return -1;
+    int pick = (int)(splitmix64(rng) % (uint64_t)popCount(legal));
+    for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+        if((legal & (Bitboard(1) << MOVE_CELL[pos.activeFactor][f])) && pick-- == 0) return f;
+    }
+    return -1;
+}
+
+// One-ply: win, else block, else the best static evaluation after the move
+int greedyFactor(const Position &pos){
+    const int side = pos.sideToMove;
+    const int opponent = opponentOf(side);
+    const Bitboard legal = legalMoves(pos);
+    int bestFactor = -1, bestScore = -INFINITE_SCORE, blockingFactor = -1;
+    for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+        int cell = MOVE_CELL[pos.activeFactor][f];
+        if(!(legal & (Bitboard(1) << cell))) continue;
+        if(hasWinLineThrough(pos.bits[side] | (Bitboard(1) << cell), cell)) return f;
+        if(blockingFactor < 0 && hasWinLineThrough(pos.bits[opponent] | (Bitboard(1) << cell), cell)){
+            blockingFactor = f;
+        }
+        Position next = pos;
+        makeMove(next, f);
+        int score = -evaluatePosition(next);
+        if(score > bestScore){
+            bestScore = score;
+            bestFactor = f;
+        }
+    }
+    return blockingFactor >= 0 ? blockingFactor : bestFactor;
+}
+
+bool readSaveFile(const std::string &path, Position &pos){
+    std::vector<SaveSlot> slots;
+    if(readSaveSlots(path, slots)){
+        const SaveSlot *newest = nullptr;
+        for(const SaveSlot &slot : slots){
+            if(slot.used && (!newest || slot.savedAt > newest->savedAt)) newest = &slot;
+        }
+        if(!newest) return false;
+        pos = newest->pos;
+        return true;
+    }
+    std::ifstream in(path, std::ios::binary);
+    if(!in) return false;
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const char *cursor = text.data();
+    return parseTextPosition(cursor, text.data() + text.size(), pos) == TEXT_VALID;
+}
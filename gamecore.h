@@ -0,0 +1,53 @@
+// gamecore.h
+#ifndef GAMECORE_H
+#define GAMECORE_H
+
+#include <cstdint>
+#include <string>
+#include "position.h"
+
+// A whole game on top of Position: forced passes, wins and draws. Holds no
+// global state and does no I/O, so any number of games can run at once.
+class Game {
+public:
+    Game(int firstFactor, int firstSide);
+    // Continues from any position, e.g. one read from a save file or sent by a client
+    explicit Game(const Position &start);
+
+    const Position &position() const { return pos; }
+    int activeFactor() const { return pos.activeFactor; }
+    int sideToMove() const { return pos.sideToMove; }
+    Bitboard legalMoves() const { return ::legalMoves(pos); }
+    bool isLegal(int factor) const { return !isOver() && isLegalFactor(pos, factor); }
+
+    // Marks activeFactor * factor for the side to move, then applies any
+    // forced pass. Returns false and changes nothing if the move is illegal.
+    bool play(int factor);
+
+    bool isOver() const { return outcome != NO_PLAYER; }
+    int result() const { return outcome; }         // NO_PLAYER while running, the winner or DRAW_RESULT
+    bool endedDead() const { return dead; }        // drawn because no line could still be completed
+    int lastCell() const { return last; }
+    int moves() const { return moveCount; }
+    int passes() const { return passCount; }
+
+private:
+    void settle();
+
+    Position pos;
+    int outcome = NO_PLAYER;
+    bool dead = false;
+    int last = -1;
+    int moveCount = 0;
+    int passCount = 0;
+};
+
+// Engines that need no search state; `rng` is any caller-owned seed
+int randomFactor(const Position &pos, uint64_t &rng);
+int greedyFactor(const Position &pos);
+
+// Reads a position from a multiplication_save.txt style file, or the most
+// recently saved slot of a multiplication_saves.bin style file
+bool readSaveFile(const std::string &path, Position &pos);
+
+#endif
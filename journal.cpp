@@ -0,0 +1,226 @@
+#include "journal.h"
+#include "savefile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+const char JOURNAL_MAGIC[8] = {'M', 'G', 'J', 'R', 'N', 'L', '0', '1'};
+
+struct JournalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+};
+
+struct JournalRecord {
+    uint8_t event;
+    uint8_t player;          // mover, or the result for JOURNAL_END
+    uint8_t factor;          // or the number of plies for JOURNAL_UNDO
+    int8_t cell;
+    uint8_t board[PACKED_BOARD_BYTES];   // JOURNAL_START and JOURNAL_SNAPSHOT only
+    uint8_t activeFactor;
+    uint8_t sideToMove;
+    uint8_t check;           // detects a torn or garbled record
+};
+
+static_assert(sizeof(JournalRecord) == 7 + PACKED_BOARD_BYTES, "journal records are written and read whole, without padding");
+
+JournalHeader makeHeader(){
+    JournalHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header.version = 1;
+    header.recordSize = sizeof(JournalRecord);
+    return header;
+}
+
+uint8_t recordCheck(const JournalRecord &record){
+    const uint8_t *bytes = (const uint8_t *)&record;
+    uint8_t check = 0xA5;
+    for(size_t i = 0; i < sizeof(record) - 1; i++) check = (uint8_t)((check << 1 | check >> 7) ^ bytes[i]);
+    return check;
+}
+
+JournalRecord makeRecord(int event, int player, int factor, int cell){
+    JournalRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.event = (uint8_t)event;
+    record.player = (uint8_t)player;
+    record.factor = (uint8_t)factor;
+    record.cell = (int8_t)cell;
+    return record;
+}
+
+JournalRecord boardRecord(int event, const Position &pos){
+    JournalRecord record = makeRecord(event, pos.sideToMove, 0, -1);
+    packBoard(pos, record.board);
+    record.activeFactor = (uint8_t)pos.activeFactor;
+    record.sideToMove = (uint8_t)pos.sideToMove;
+    return record;
+}
+
+} // namespace
+
+JournalWriter::~JournalWriter(){
+    close();
+}
+
+bool JournalWriter::begin(const std::string &path, const Position &start){
+    close();
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) return false;
+    JournalHeader header = makeHeader();
+    JournalRecord record = boardRecord(JOURNAL_START, start);
+    plies = 0;
+    unsynced = 0;
+    if(::write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) || !append(&record)){
+        close();
+        return false;
+    }
+    ::fdatasync(fd);
+    unsynced = 0;
+    return true;
+}
+
+bool JournalWriter::resume(const std::string &path, size_t validBytes, int journalPlies){
+    close();
+    fd = ::open(path.c_str(), O_WRONLY);
+    if(fd < 0) return false;
+    // Drop a torn tail so new records follow the last intact one
+    if(::ftruncate(fd, (off_t)validBytes) != 0 || ::lseek(fd, 0, SEEK_END) < 0){
+        close();
+        return false;
+    }
+    plies = journalPlies;
+    unsynced = 0;
+    return true;
+}
+
+bool JournalWriter::append(const void *data){
+    JournalRecord record;
+    std::memcpy(&record, data, sizeof(record));
+    record.check = recordCheck(record);
+    if(::write(fd, &record, sizeof(record)) != (ssize_t)sizeof(record)) return false;
+    if(++unsynced >= JOURNAL_SYNC_BATCH){
+        ::fdatasync(fd);
+        unsynced = 0;
+    }
+    return true;
+}
+
+void JournalWriter::snapshotIfDue(const Position &after){
+    if(++plies % JOURNAL_SNAPSHOT_INTERVAL != 0) return;
+    JournalRecord record = boardRecord(JOURNAL_SNAPSHOT, after);
+    append(&record);
+}
+
+void JournalWriter::move(int player, int factor, int cell, const Position &after){
+    if(fd < 0) return;
+    JournalRecord record = makeRecord(JOURNAL_MOVE, player, factor, cell);
+    if(append(&record)) snapshotIfDue(after);
+}
+
+void JournalWriter::pass(int player, const Position &after){
+    if(fd < 0) return;
+    JournalRecord record = makeRecord(JOURNAL_PASS, player, 0, -1);
+    if(append(&record)) snapshotIfDue(after);
+}
+
+void JournalWriter::undo(int count){
+    if(fd < 0 || count <= 0) return;
+    JournalRecord record = makeRecord(JOURNAL_UNDO, NO_PLAYER, count, -1);
+    if(append(&record)) plies -= count;
+}
+
+void JournalWriter::end(int result){
+    if(fd < 0) return;
+    JournalRecord record = makeRecord(JOURNAL_END, result, 0, -1);
+    append(&record);
+    close();
+}
+
+void JournalWriter::close(){
+    if(fd < 0) return;
+    if(unsynced) ::fdatasync(fd);
+    ::close(fd);
+    fd = -1;
+    unsynced = 0;
+}
+
+bool JournalReplay::load(const std::string &path){
+    history.clear();
+    snapshots.clear();
+    hasEnd = false;
+    endResult = NO_PLAYER;
+    intactBytes = 0;
+
+    FILE *in = std::fopen(path.c_str(), "rb");
+    if(!in) return false;
+    JournalHeader header, expected = makeHeader();
+    JournalRecord record;
+    bool ok = std::fread(&header, sizeof(header), 1, in) == 1 && std::memcmp(&header, &expected, sizeof(header)) == 0
+           && std::fread(&record, sizeof(record), 1, in) == 1 && record.check == recordCheck(record)
+           && record.event == JOURNAL_START;
+    Position pos;
+    ok = ok && unpackBoard(record.board, record.activeFactor, record.sideToMove, pos);
+    if(!ok){
+        std::fclose(in);
+        return false;
+    }
+    snapshots.push_back(pos);
+    intactBytes = sizeof(header) + sizeof(record);
+
+    // Replays as it reads so a record that does not fit the game is treated like a torn one.
+    // Snapshots are kept from the replay itself; the file's copies must agree with them,
+    // and one lost in a torn tail before a resume is simply rebuilt here.
+    while(!hasEnd && std::fread(&record, sizeof(record), 1, in) == 1 && record.check == recordCheck(record)){
+        if(record.event == JOURNAL_MOVE){
+            if(record.player != pos.sideToMove || !isLegalFactor(pos, record.factor)) break;
+            int cell = makeMove(pos, record.factor);
+            if(cell != record.cell) break;
+            history.push_back({JOURNAL_MOVE, record.player, record.factor, cell});
+        }else if(record.event == JOURNAL_PASS){
+            if(record.player != pos.sideToMove || legalMoves(pos)) break;
+            makePass(pos);
+            history.push_back({JOURNAL_PASS, record.player, 0, -1});
+        }else if(record.event == JOURNAL_SNAPSHOT){
+            Position snapshot;
+            if(history.size() % JOURNAL_SNAPSHOT_INTERVAL != 0
+               || !unpackBoard(record.board, record.activeFactor, record.sideToMove, snapshot)
+               || snapshot.key != pos.key){
+                break;
+            }
+        }else if(record.event == JOURNAL_UNDO){
+            if(record.factor == 0 || record.factor > history.size()) break;
+            history.resize(history.size() - record.factor);
+            snapshots.resize(history.size() / JOURNAL_SNAPSHOT_INTERVAL + 1);
+            pos = positionAt(plies());
+        }else if(record.event == JOURNAL_END){
+            hasEnd = true;
+            endResult = record.player;
+        }else{
+            break;
+        }
+        if((record.event == JOURNAL_MOVE || record.event == JOURNAL_PASS)
+           && history.size() % JOURNAL_SNAPSHOT_INTERVAL == 0){
+            snapshots.push_back(pos);
+        }
+        intactBytes += sizeof(record);
+    }
+    std::fclose(in);
+    return true;
+}
+
+Position JournalReplay::positionAt(int index) const {
+    int k = std::min(index / JOURNAL_SNAPSHOT_INTERVAL, (int)snapshots.size() - 1);
+    Position pos = snapshots[k];
+    for(int i = k * JOURNAL_SNAPSHOT_INTERVAL; i < index; i++){
+        if(history[i].event == JOURNAL_PASS) makePass(pos);
+        else makeMove(pos, history[i].factor);
+    }
+    return pos;
+}
@@ -0,0 +1,82 @@
+// journal.h
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "position.h"
+
+const std::string JOURNAL_FILENAME = "multiplication" VARIANT_TAG "_journal.bin";
+const int JOURNAL_SYNC_BATCH = 8;           // records written between fdatasync calls
+const int JOURNAL_SNAPSHOT_INTERVAL = 8;    // plies between full-board snapshot records
+
+enum JournalEvent { JOURNAL_START, JOURNAL_MOVE, JOURNAL_PASS, JOURNAL_SNAPSHOT, JOURNAL_END, JOURNAL_UNDO };
+
+// One ply of a journalled game: a move or a pass
+struct JournalPly {
+    int event;       // JOURNAL_MOVE or JOURNAL_PASS
+    int player;
+    int factor;      // factor chosen, 0 for a pass
+    int cell;        // cell marked, -1 for a pass
+};
+
+// Append-only log of the game in progress. Each event is one fixed-size record
+// (16 bytes on the 6x6 board) written with a single write(); the file is only
+// synced every JOURNAL_SYNC_BATCH records and when the game ends, so logging a
+// move costs a syscall and no disk wait. Every JOURNAL_SNAPSHOT_INTERVAL plies a copy of
+// the whole board is appended as a checkpoint the reader verifies against.
+class JournalWriter {
+public:
+    JournalWriter() = default;
+    ~JournalWriter();
+    JournalWriter(const JournalWriter &) = delete;
+    JournalWriter &operator=(const JournalWriter &) = delete;
+
+    // Starts a new journal at `start`, replacing any previous one
+    bool begin(const std::string &path, const Position &start);
+    // Reopens an unfinished journal after its last intact record, `plies` long
+    bool resume(const std::string &path, size_t validBytes, int plies);
+    // `after` is the position once the move or pass has been made
+    void move(int player, int factor, int cell, const Position &after);
+    void pass(int player, const Position &after);
+    // Takes back the last `count` plies; a redo is logged as ordinary plies
+    void undo(int count);
+    // Marks the game finished (winner, DRAW_RESULT or NO_PLAYER if abandoned) and closes
+    void end(int result);
+    void close();
+    bool isOpen() const { return fd >= 0; }
+
+private:
+    bool append(const void *record);
+    void snapshotIfDue(const Position &after);
+
+    int fd = -1;
+    int plies = 0;
+    int unsynced = 0;
+};
+
+// A journal read back into memory for recovery and the replay viewer
+class JournalReplay {
+public:
+    // Reads up to the first torn or inconsistent record; false if there is no usable start
+    bool load(const std::string &path);
+
+    bool finished() const { return hasEnd; }
+    int result() const { return endResult; }
+    int plies() const { return (int)history.size(); }
+    const JournalPly &ply(int index) const { return history[index - 1]; }   // 1-based
+    // Board after `index` plies, from the nearest snapshot at or before it plus
+    // fewer than JOURNAL_SNAPSHOT_INTERVAL plies, so seeking never replays the game
+    Position positionAt(int index) const;
+    size_t validBytes() const { return intactBytes; }
+
+private:
+    std::vector<JournalPly> history;
+    std::vector<Position> snapshots;   // snapshots[k] is the board after k * JOURNAL_SNAPSHOT_INTERVAL plies
+    bool hasEnd = false;
+    int endResult = NO_PLAYER;
+    size_t intactBytes = 0;
+};
+
+#endif
@@ -0,0 +1,90 @@
+// lineeval.h
+#ifndef LINEEVAL_H
+#define LINEEVAL_H
+
+#include <array>
+#include <cstdint>
+#include "bitboard.h"
+#include "constants.h"
+
+// Weight of a line holding 0..WIN_LENGTH-1 marks of a single player:
+// 0, 2, 20, 150 for four in a row, then roughly 7x per extra mark
+constexpr std::array<int, WIN_LENGTH> buildLineWeights(){
+    std::array<int, WIN_LENGTH> weights{};
+    const int base[4] = {0, 2, 20, 150};
+    for(int m = 0; m < WIN_LENGTH; m++) weights[m] = m < 4 ? base[m] : weights[m - 1] * 7;
+    return weights;
+}
+
+constexpr std::array<int, WIN_LENGTH> LINE_WEIGHTS = buildLineWeights();
+
+// A line's state is its human marks * LINE_STATE_BASE + its computer marks
+const int LINE_STATE_BASE = WIN_LENGTH + 1;
+const int NUM_LINE_STATES = LINE_STATE_BASE * LINE_STATE_BASE;
+static_assert(NUM_LINE_STATES <= 256, "line states are stored in a byte");
+
+// Score of every line state for the human: an open line counts for whoever
+// holds it, a blocked one for nobody, and a complete one ends the game first
+constexpr std::array<int, NUM_LINE_STATES> buildLineStateScores(){
+    std::array<int, NUM_LINE_STATES> scores{};
+    for(int human = 0; human < WIN_LENGTH; human++){
+        for(int computer = 0; computer < WIN_LENGTH; computer++){
+            int score = 0;
+            if(computer == 0) score = LINE_WEIGHTS[human];
+            else if(human == 0) score = -LINE_WEIGHTS[computer];
+            scores[human * LINE_STATE_BASE + computer] = score;
+        }
+    }
+    return scores;
+}
+
+constexpr std::array<int, NUM_LINE_STATES> LINE_STATE_SCORES = buildLineStateScores();
+
+inline int lineState(Bitboard human, Bitboard computer, Bitboard line){
+    return popCount(human & line) * LINE_STATE_BASE + popCount(computer & line);
+}
+
+// The state of every win line, updated in O(lines through the cell) per mark
+// so the position's score is a single read. Kept next to a Position by
+// whoever makes and unmakes its moves, such as MoveStack.
+class LineEvaluator {
+public:
+    void reset(Bitboard human, Bitboard computer){
+        humanScore = 0;
+        for(int i = 0; i < NUM_WIN_LINES; i++){
+            state[i] = (uint8_t)lineState(human, computer, WIN_LINES[i]);
+            humanScore += LINE_STATE_SCORES[state[i]];
+        }
+    }
+
+    void mark(int cell, int player){
+        const int step = player == HUMAN_PLAYER ? LINE_STATE_BASE : 1;
+        const CellLines &lines = CELL_LINES[cell];
+        for(int k = 0; k < lines.count; k++){
+            uint8_t &line = state[lines.index[k]];
+            humanScore += LINE_STATE_SCORES[line + step] - LINE_STATE_SCORES[line];
+            line += step;
+        }
+    }
+
+    void unmark(int cell, int player){
+        const int step = player == HUMAN_PLAYER ? LINE_STATE_BASE : 1;
+        const CellLines &lines = CELL_LINES[cell];
+        for(int k = 0; k < lines.count; k++){
+            uint8_t &line = state[lines.index[k]];
+            line -= step;
+            humanScore += LINE_STATE_SCORES[line] - LINE_STATE_SCORES[line + step];
+        }
+    }
+
+    // Open-line weights of `player` minus those of the opponent
+    int score(int player) const {
+        return player == HUMAN_PLAYER ? humanScore : -humanScore;
+    }
+
+private:
+    uint8_t state[NUM_WIN_LINES];
+    int humanScore = 0;
+};
+
+#endif
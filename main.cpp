@@ -2,11 +2,30 @@
 #include "menu.h"
 #include "utils.h"
 #include "board.h"
+#include "config.h"
+#include "mcts.h"
+#include "metrics.h"
 #include <ncurses.h>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
 
-int main() {
+int main(int argc, char **argv) {
+    std::string error;
+    if (!parseCommandLine(argc, argv, gameConfig, error)) {
+        if (!error.empty()) std::fprintf(stderr, "%s\n", error.c_str());
+        printUsage(argv[0]);
+        return error.empty() ? 0 : 1;
+    }
+    if ((size_t)gameConfig.hashMb != searchTable.sizeMb()) searchTable.resize(gameConfig.hashMb);
+    solvedDatabase.open(gameConfig.solvedDbPath);
+    openingBook.open(gameConfig.bookPath);
+    if (!gameConfig.metricsPath.empty() && !metricsLog.open(gameConfig.metricsPath)) {
+        std::fprintf(stderr, "Could not open %s\n", gameConfig.metricsPath.c_str());
+        return 1;
+    }
+    if (gameConfig.engine == ENGINE_MCTS) mctsEngine.reset(new MctsEngine(gameConfig.mctsNodes));
+
     srand(time(0));
     initializeBoard();
     initscr();
@@ -26,6 +45,11 @@ int main() {
     int menuChoice = -1;
     bool gameLoadedSuccessfully = false;
 
+    GameState recovered;
+    if (recoverJournal(recovered)) playGame(recovered, true);
+    clear();
+    refresh();
+
     do {
         gameLoadedSuccessfully = false;
         showMainMenu(menuChoice);
@@ -37,25 +61,57 @@ int main() {
                 break;
             case 1: // Load Game
                 if (loadGame(state)) {
-                    showTempMessage("Game Loaded!", COLOR_PAIR(2) | A_BOLD, 3, 20, 1500);
+                    showTempMessage("Game Loaded!", COLOR_PAIR(2) | A_BOLD, 1500);
                     gameLoadedSuccessfully = true;
                 } else {
-                    showTempMessage("Failed to load game or no save file found.", COLOR_PAIR(1) | A_BOLD, 3, 50, 2000);
+                    showTempMessage("Failed to load game or no save file found.", COLOR_PAIR(1) | A_BOLD, 2000);
+                    pauseUi(2000);
+                    dismissToasts();
                     clear();
                     refresh();
                 }
                 if (gameLoadedSuccessfully) playGame(state, true);
                 break;
-            case 2: // How to Play
+            case 2: // Replay Game
+                showReplay();
+                break;
+            case 3: // How to Play
                 showInstructions();
                 clear();
                 refresh();
                 break;
-            case 3: // Exit
+            case 4: // Exit
                 break;
         }
-    } while (menuChoice != 3);
+    } while (menuChoice != 4);
 
+    stopPondering();
     endwin();
+    if (searchTable.probes() > 0) {
+        std::printf("Transposition table: %zu MB, %.1f%% hit rate, %.1f%% full\n",
+                    searchTable.sizeMb(), 100.0 * searchTable.hitRate(),
+                    searchTable.fillPermille() / 10.0);
+    }
+    if (searchThreadNodes.size() > 1) {
+        std::printf("Search threads: %zu, nodes per thread:", searchThreadNodes.size());
+        for (uint64_t nodes : searchThreadNodes) std::printf(" %llu", (unsigned long long)nodes);
+        std::printf("\n");
+    }
+    if (bookMoves > 0) {
+        std::printf("Opening book: %llu moves played from %llu booked positions\n", (unsigned long long)bookMoves,
+                    (unsigned long long)openingBook.size());
+    }
+    if (ponderHits + ponderMisses > 0) {
+        std::printf("Pondering: %llu of %llu replies ready when needed\n", (unsigned long long)ponderHits,
+                    (unsigned long long)(ponderHits + ponderMisses));
+    }
+    if (metricsLog.written() > 0) {
+        std::printf("Metrics: %llu computer moves appended to %s\n", (unsigned long long)metricsLog.written(),
+                    gameConfig.metricsPath.c_str());
+    }
+    if (mctsPlayouts > 0) {
+        std::printf("MCTS: %llu playouts, %.0f playouts/sec\n", (unsigned long long)mctsPlayouts,
+                    mctsElapsedMs > 0 ? mctsPlayouts * 1000.0 / mctsElapsedMs : 0.0);
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,264 @@
+#include "mcts.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const double EXPLORATION = 1.0;
+const int MAX_PATH = 2 * NUM_CELLS + 2;   // every mark plus a pass before each
+
+// xorshift64*, one stream per worker so playouts never share state
+struct PlayoutRng {
+    uint64_t state;
+    explicit PlayoutRng(uint64_t seed) : state(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+    uint32_t next(uint32_t bound){
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return (uint32_t)(((state * 0x2545F4914F6CDD1DULL) >> 32) % bound);
+    }
+};
+
+// Result of a finished child position, NO_PLAYER while the game goes on
+int terminalResult(const Position &pos, int cell, int mover){
+    if(cell >= 0 && wonAt(pos, cell, mover)) return mover;
+    if(isDead(pos)) return DRAW_RESULT;
+    if(!legalMoves(pos)){
+        Position passed = pos;
+        makePass(passed);
+        if(!legalMoves(passed)) return DRAW_RESULT;
+    }
+    return NO_PLAYER;
+}
+
+// Light policy: take an immediate win, otherwise a uniformly random factor
+int playout(Position pos, PlayoutRng &rng){
+    bool afterPass = false;
+    while(true){
+        Bitboard legal = legalMoves(pos);
+        if(!legal){
+            if(afterPass) return DRAW_RESULT;
+            makePass(pos);
+            afterPass = true;
+            continue;
+        }
+        afterPass = false;
+        if(isDead(pos)) return DRAW_RESULT;
+
+        const int side = pos.sideToMove;
+        int factors[MAX_FACTOR];
+        int count = 0;
+        for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+            int cell = MOVE_CELL[pos.activeFactor][f];
+            if(!(legal & (Bitboard(1) << cell))) continue;
+            if(hasWinLineThrough(pos.bits[side] | (Bitboard(1) << cell), cell)) return side;
+            factors[count++] = f;
+        }
+        makeMove(pos, factors[rng.next(count)]);
+    }
+}
+
+} // namespace
+
+MctsEngine::MctsEngine(size_t maxNodes)
+    : nodes(new Node[maxNodes]), capacity(maxNodes) {}
+
+void MctsEngine::reset(){
+    used.store(0);
+    root = -1;
+}
+
+// Contiguous block of `count` nodes from the arena, -1 when it is full
+int32_t MctsEngine::allocate(int count){
+    size_t index = used.fetch_add(count);
+    if(index + count > capacity){
+        used.fetch_sub(count);
+        return -1;
+    }
+    return (int32_t)index;
+}
+
+void MctsEngine::initNode(int32_t index, int factor, uint64_t key, int terminal){
+    Node &node = nodes[index];
+    node.visits.store(0, std::memory_order_relaxed);
+    node.score.store(0, std::memory_order_relaxed);
+    node.state.store(0, std::memory_order_relaxed);
+    node.factor = (uint8_t)factor;
+    node.childCount = 0;
+    node.terminal = (uint8_t)terminal;
+    node.firstChild = -1;
+    node.key = key;
+}
+
+// Only one thread expands a node; the others keep doing playouts from it
+bool MctsEngine::expand(int32_t index, const Position &pos){
+    Node &node = nodes[index];
+    uint8_t expected = 0;
+    if(!node.state.compare_exchange_strong(expected, 1, std::memory_order_acquire)) return false;
+
+    Bitboard legal = legalMoves(pos);
+    int count = legal ? popCount(legal) : 1;
+    int32_t first = allocate(count);
+    if(first < 0){
+        node.state.store(0, std::memory_order_release);
+        return false;
+    }
+
+    int32_t child = first;
+    if(!legal){
+        Position next = pos;
+        makePass(next);
+        initNode(child, 0, next.key, terminalResult(next, -1, pos.sideToMove));
+    }else{
+        for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+            if(!(legal & (Bitboard(1) << MOVE_CELL[pos.activeFactor][f]))) continue;
+            Position next = pos;
+            int cell = makeMove(next, f);
+            initNode(child++, f, next.key, terminalResult(next, cell, pos.sideToMove));
+        }
+    }
+    node.firstChild = first;
+    node.childCount = (uint8_t)count;
+    node.state.store(2, std::memory_order_release);
+    return true;
+}
+
+// UCT; visits already include the virtual losses of in-flight playouts
+int32_t MctsEngine::selectChild(const Node &parent) const {
+    double logParent = std::log((double)std::max(1, parent.visits.load(std::memory_order_relaxed)));
+    int32_t best = parent.firstChild;
+    double bestValue = -1.0;
+    for(int i = 0; i < parent.childCount; i++){
+        const Node &child = nodes[parent.firstChild + i];
+        int visits = child.visits.load(std::memory_order_relaxed);
+        if(visits == 0) return parent.firstChild + i;
+        double value = child.score.load(std::memory_order_relaxed) / (2.0 * visits)
+                     + EXPLORATION * std::sqrt(logParent / visits);
+        if(value > bestValue){
+            bestValue = value;
+            best = parent.firstChild + i;
+        }
+    }
+    return best;
+}
+
+// The new root is usually a grandchild of the old one: our move, then the reply
+int32_t MctsEngine::findSubtree(uint64_t key) const {
+    if(root < 0) return -1;
+    if(nodes[root].key == key) return root;
+    const Node &top = nodes[root];
+    if(top.state.load() != 2) return -1;
+    for(int i = 0; i < top.childCount; i++){
+        const Node &child = nodes[top.firstChild + i];
+        if(child.key == key) return top.firstChild + i;
+        if(child.state.load() != 2) continue;
+        for(int j = 0; j < child.childCount; j++){
+            if(nodes[child.firstChild + j].key == key) return child.firstChild + j;
+        }
+    }
+    return -1;
+}
+
+void MctsEngine::runWorker(const Position &rootPos, int threadId, const MctsLimits &limits){
+    PlayoutRng rng(limits.seed ^ (uint64_t)(threadId + 1) * 0xD1B54A32D192ED03ULL);
+    const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(limits.timeMs);
+    int32_t path[MAX_PATH];
+    int movers[MAX_PATH];
+
+    for(uint64_t iteration = 0; !stop.load(std::memory_order_relaxed); iteration++){
+        if((iteration & 63) == 0 && Clock::now() >= deadline) stop.store(true);
+        if(limits.maxPlayouts && playouts.load(std::memory_order_relaxed) >= limits.maxPlayouts) stop.store(true);
+
+        // Selection: visits go up on the way down, acting as a virtual loss
+        Position pos = rootPos;
+        int length = 0;
+        int32_t index = root;
+        nodes[index].visits.fetch_add(1, std::memory_order_relaxed);
+        path[length++] = index;
+        int result;
+        while(true){
+            Node &node = nodes[index];
+            if(node.terminal != NO_PLAYER){
+                result = node.terminal;
+                break;
+            }
+            if(node.state.load(std::memory_order_acquire) != 2){
+                bool fresh = node.visits.load(std::memory_order_relaxed) <= 1 && index != root;
+                if(fresh || !expand(index, pos)){
+                    result = playout(pos, rng);
+                    break;
+                }
+            }
+            int32_t child = selectChild(node);
+            nodes[child].visits.fetch_add(1, std::memory_order_relaxed);
+            movers[length] = pos.sideToMove;
+            if(nodes[child].factor == 0) makePass(pos);
+            else makeMove(pos, nodes[child].factor);
+            path[length++] = child;
+            index = child;
+        }
+
+        // Backpropagation: score for the player who made the move into each node
+        for(int i = 1; i < length; i++){
+            int gain = result == movers[i] ? 2 : result == DRAW_RESULT ? 1 : 0;
+            nodes[path[i]].score.fetch_add(gain, std::memory_order_relaxed);
+        }
+        playouts.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+MctsResult MctsEngine::search(const Position &pos, const MctsLimits &limits){
+    MctsResult result;
+    if(!legalMoves(pos)) return result;
+    const Clock::time_point start = Clock::now();
+
+    int32_t subtree = findSubtree(pos.key);
+    if(subtree >= 0 && used.load() < capacity / 4 * 3){
+        root = subtree;
+        result.reusedTree = true;
+    }else{
+        reset();
+        root = allocate(1);
+        initNode(root, 0, pos.key, NO_PLAYER);
+    }
+
+    stop.store(false);
+    playouts.store(0);
+    const int threadCount = std::max(1, limits.threads);
+    std::vector<std::thread> helpers;
+    for(int i = 1; i < threadCount; i++){
+        helpers.emplace_back([this, &pos, i, &limits](){ runWorker(pos, i, limits); });
+    }
+    runWorker(pos, 0, limits);
+    for(auto &helper : helpers) helper.join();
+
+    const Node &top = nodes[root];
+    int bestVisits = -1;
+    for(int i = 0; i < top.childCount; i++){
+        const Node &child = nodes[top.firstChild + i];
+        int visits = child.visits.load();
+        if(visits > bestVisits){
+            bestVisits = visits;
+            result.factor = child.factor;
+            result.winRate = visits ? child.score.load() / (2.0 * visits) : 0.0;
+        }
+    }
+    if(result.factor <= 0){
+        // Not even the root could be expanded: fall back to the first legal factor
+        Bitboard legal = legalMoves(pos);
+        for(int f = MIN_FACTOR; f <= MAX_FACTOR && result.factor <= 0; f++){
+            if(legal & (Bitboard(1) << MOVE_CELL[pos.activeFactor][f])) result.factor = f;
+        }
+    }
+
+    result.playouts = playouts.load();
+    result.elapsedMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+    result.playoutsPerSec = result.elapsedMs > 0 ? result.playouts * 1000.0 / result.elapsedMs : 0.0;
+    result.nodesUsed = used.load();
+    return result;
+}
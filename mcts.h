@@ -0,0 +1,68 @@
+// mcts.h
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "position.h"
+
+const size_t DEFAULT_MCTS_NODES = 1 << 21;
+
+struct MctsLimits {
+    int timeMs = 1000;
+    int threads = 1;
+    uint64_t maxPlayouts = 0;   // 0 = until the time runs out
+    uint64_t seed = 1;          // playout RNG seed, per-thread streams derive from it
+};
+
+struct MctsResult {
+    int factor = -1;            // most visited root factor, -1 when the side to move has to pass
+    double winRate = 0.0;       // of the chosen factor, draws count half
+    uint64_t playouts = 0;
+    double playoutsPerSec = 0.0;
+    size_t nodesUsed = 0;
+    bool reusedTree = false;    // the search continued a subtree from the previous turn
+    int elapsedMs = 0;
+};
+
+// Monte Carlo Tree Search with UCT selection, parallel playouts using virtual
+// loss, nodes taken from a fixed arena and the tree kept between turns.
+class MctsEngine {
+public:
+    explicit MctsEngine(size_t maxNodes = DEFAULT_MCTS_NODES);
+    MctsEngine(const MctsEngine &) = delete;
+    MctsEngine &operator=(const MctsEngine &) = delete;
+
+    MctsResult search(const Position &pos, const MctsLimits &limits);
+    void reset();
+
+private:
+    struct Node {
+        std::atomic<int32_t> visits;
+        std::atomic<int32_t> score;     // 2 per win, 1 per draw, for the player who moved into the node
+        std::atomic<uint8_t> state;     // 0 leaf, 1 being expanded, 2 expanded
+        uint8_t factor;                 // move from the parent, 0 = pass
+        uint8_t childCount;
+        uint8_t terminal;               // NO_PLAYER, the winner, or DRAW_RESULT
+        int32_t firstChild;
+        uint64_t key;
+    };
+
+    int32_t allocate(int count);
+    void initNode(int32_t index, int factor, uint64_t key, int terminal);
+    bool expand(int32_t index, const Position &pos);
+    int32_t selectChild(const Node &parent) const;
+    int32_t findSubtree(uint64_t key) const;
+    void runWorker(const Position &root, int threadId, const MctsLimits &limits);
+
+    std::unique_ptr<Node[]> nodes;
+    size_t capacity;
+    std::atomic<size_t> used{0};
+    int32_t root = -1;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> playouts{0};
+};
+
+#endif
@@ -3,8 +3,12 @@
 
 #include <ncurses.h>
 #include <menu.h>
+#include <string>
+#include <vector>
 
 void showMainMenu(int &choice);
 void showInstructions();
+// Scrollable list of choices; returns the chosen index or -1 if the user backs out with 'q'
+int showListMenu(const std::string &title, const std::vector<std::string> &entries);
 
 #endif
\ No newline at end of file
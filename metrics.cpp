@@ -0,0 +1,47 @@
+#include "metrics.h"
+#include <ctime>
+
+MoveMetrics lastMoveMetrics;
+uint64_t moveMetricsVersion = 0;
+// Opened by main() for --metrics
+MetricsLog metricsLog;
+
+MetricsLog::~MetricsLog(){
+    close();
+}
+
+bool MetricsLog::open(const std::string &path){
+    close();
+    file = std::fopen(path.c_str(), "a");
+    return file != nullptr;
+}
+
+void MetricsLog::append(const MoveMetrics &m){
+    if(!file) return;
+    std::string scores, bounds;
+    for(size_t f = 0; f < m.factorScores.size(); f++){
+        if(m.factorScores[f] == NO_FACTOR_SCORE) continue;
+        if(!scores.empty()){
+            scores += ", ";
+            bounds += ", ";
+        }
+        scores += "\"" + std::to_string(f) + "\": " + std::to_string(m.factorScores[f]);
+        bounds += "\"" + std::to_string(f) + "\": " + (m.isUpperBound(f) ? "\"upper\"" : "\"exact\"");
+    }
+    std::fprintf(file, "{\"time\": %lld, \"ply\": %d, \"key\": \"%016llx\", \"source\": \"%s\", \"factor\": %d, "
+                       "\"elapsed_ms\": %.3f, \"nodes\": %llu, \"nodes_per_sec\": %.0f, \"depth\": %d, "
+                       "\"tt_probes\": %llu, \"tt_hits\": %llu, \"score\": ",
+                 (long long)std::time(nullptr), m.ply, (unsigned long long)m.key, m.source, m.factor,
+                 m.elapsedMs, (unsigned long long)m.nodes, m.nodesPerSec(), m.depth,
+                 (unsigned long long)m.ttProbes, (unsigned long long)m.ttHits);
+    if(m.hasScore) std::fprintf(file, "%d", m.score);
+    else std::fputs("null", file);
+    std::fprintf(file, ", \"factor_scores\": {%s}, \"factor_bounds\": {%s}}\n", scores.c_str(), bounds.c_str());
+    std::fflush(file);
+    lines++;
+}
+
+void MetricsLog::close(){
+    if(file) std::fclose(file);
+    file = nullptr;
+}
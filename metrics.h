@@ -0,0 +1,60 @@
+// metrics.h
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+const int NO_FACTOR_SCORE = INT_MIN;
+
+// What one computer move cost and why it was chosen: filled in by
+// computerChooseFactor(), shown by the search panel and logged with --metrics
+struct MoveMetrics {
+    const char *source = "";          // solved, book, ponder, search, mcts or greedy
+    int factor = -1;
+    int ply = 0;                      // plies since the game started or was loaded
+    uint64_t key = 0;                 // Position::key the move was chosen in
+    double elapsedMs = 0.0;           // wall time of computerChooseFactor()
+    uint64_t nodes = 0;               // search nodes, or MCTS playouts
+    int depth = 0;
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    bool hasScore = false;
+    int score = 0;                    // from the computer's point of view, MCTS win rate in percent
+    std::vector<int> factorScores;    // by factor, NO_FACTOR_SCORE where a factor was not scored
+    std::vector<bool> factorUpper;    // by factor, true where the score is only an upper bound
+
+    bool isUpperBound(size_t factor) const { return factor < factorUpper.size() && factorUpper[factor]; }
+    double nodesPerSec() const { return elapsedMs > 0.0 ? nodes * 1000.0 / elapsedMs : 0.0; }
+};
+
+// Last computer move, and a count the search panel compares to redraw only after a new one
+extern MoveMetrics lastMoveMetrics;
+extern uint64_t moveMetricsVersion;
+
+// Appends one JSON object per computer move to a file, flushed line by line
+// so a crash loses at most the move being written
+class MetricsLog {
+public:
+    MetricsLog() = default;
+    ~MetricsLog();
+    MetricsLog(const MetricsLog &) = delete;
+    MetricsLog &operator=(const MetricsLog &) = delete;
+
+    bool open(const std::string &path);
+    void append(const MoveMetrics &metrics);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+    uint64_t written() const { return lines; }
+
+private:
+    FILE *file = nullptr;
+    uint64_t lines = 0;
+};
+
+extern MetricsLog metricsLog;
+
+#endif
@@ -0,0 +1,76 @@
+// movegen.h
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include <array>
+#include "bitboard.h"
+
+// Board layout: every distinct product of two factors in ascending order,
+// row by row, with 0 for the blank cells a factor range may leave at the end
+constexpr std::array<int, NUM_CELLS> buildBoardLayout(){
+    std::array<int, NUM_CELLS> layout{};
+    int n = 0;
+    for(int product = 1; product <= MAX_PRODUCT; product++){
+        for(int a = MIN_FACTOR; a <= MAX_FACTOR; a++){
+            if(product % a == 0 && product / a >= MIN_FACTOR && product / a <= MAX_FACTOR){
+                layout[n++] = product;
+                break;
+            }
+        }
+    }
+    return layout;
+}
+
+constexpr std::array<int, NUM_CELLS> BOARD_LAYOUT = buildBoardLayout();
+
+// Cell index holding each product, -1 if the product is not on the board
+constexpr std::array<int, MAX_PRODUCT + 1> buildProductCells(){
+    std::array<int, MAX_PRODUCT + 1> cells{};
+    for(auto &cell : cells) cell = -1;
+    for(int i = 0; i < NUM_PLAYABLE_CELLS; i++) cells[BOARD_LAYOUT[i]] = i;
+    return cells;
+}
+
+constexpr std::array<int, MAX_PRODUCT + 1> PRODUCT_CELL = buildProductCells();
+
+// Cell marked by playing `factor` against `activeFactor`, -1 if none
+constexpr std::array<std::array<int, MAX_FACTOR + 1>, MAX_FACTOR + 1> buildMoveCells(){
+    std::array<std::array<int, MAX_FACTOR + 1>, MAX_FACTOR + 1> cells{};
+    for(int a = 0; a <= MAX_FACTOR; a++){
+        for(int f = 0; f <= MAX_FACTOR; f++){
+            bool inRange = a >= MIN_FACTOR && f >= MIN_FACTOR;
+            cells[a][f] = inRange ? PRODUCT_CELL[a * f] : -1;
+        }
+    }
+    return cells;
+}
+
+constexpr std::array<std::array<int, MAX_FACTOR + 1>, MAX_FACTOR + 1> MOVE_CELL = buildMoveCells();
+
+// Cells reachable from each activeFactor with any factor
+constexpr std::array<Bitboard, MAX_FACTOR + 1> buildReachable(){
+    std::array<Bitboard, MAX_FACTOR + 1> masks{};
+    for(int a = MIN_FACTOR; a <= MAX_FACTOR; a++){
+        for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+            if(MOVE_CELL[a][f] >= 0) masks[a] |= Bitboard(1) << MOVE_CELL[a][f];
+        }
+    }
+    return masks;
+}
+
+constexpr std::array<Bitboard, MAX_FACTOR + 1> REACHABLE = buildReachable();
+
+inline bool isFactor(int factor){
+    return factor >= MIN_FACTOR && factor <= MAX_FACTOR;
+}
+
+inline int productCell(int product){
+    return (product >= 0 && product <= MAX_PRODUCT) ? PRODUCT_CELL[product] : -1;
+}
+
+// Unoccupied cells the side to move can mark
+inline Bitboard legalMoves(int activeFactor, Bitboard occupied){
+    return isFactor(activeFactor) ? (REACHABLE[activeFactor] & ~occupied) : 0;
+}
+
+#endif
@@ -0,0 +1,260 @@
+#include "movescore.h"
+#include "game.h"
+#include "board.h"
+#include "movegen.h"
+#include <array>
+#include <limits>
+
+namespace {
+
+// One product per factor of the active factor
+const int MAX_CANDIDATES = MAX_FACTOR;
+
+// Each kernel holds one bitboard per direction of `directions` in a lane, so
+// a shift moves every cell one step along all four directions at once
+#if (defined(__x86_64__) || defined(__i386__)) && MG_BOARD_SIZE * MG_BOARD_SIZE <= 64
+#define MOVESCORE_X86_KERNELS 1
+typedef uint64_t VectorLanes __attribute__((vector_size(32)));
+#endif
+
+// Plain per-lane fallback, also the only kernel for boards wider than 64 bits
+struct ScalarLanes {
+    Bitboard lane[4];
+
+    ScalarLanes() = default;
+    ScalarLanes(Bitboard a, Bitboard b, Bitboard c, Bitboard d) : lane{a, b, c, d} {}
+    Bitboard operator[](int d) const { return lane[d]; }
+    friend ScalarLanes operator&(const ScalarLanes &a, const ScalarLanes &b){
+        return {a.lane[0] & b.lane[0], a.lane[1] & b.lane[1], a.lane[2] & b.lane[2], a.lane[3] & b.lane[3]};
+    }
+    friend ScalarLanes operator|(const ScalarLanes &a, const ScalarLanes &b){
+        return {a.lane[0] | b.lane[0], a.lane[1] | b.lane[1], a.lane[2] | b.lane[2], a.lane[3] | b.lane[3]};
+    }
+    friend ScalarLanes operator~(const ScalarLanes &a){
+        return {~a.lane[0], ~a.lane[1], ~a.lane[2], ~a.lane[3]};
+    }
+    friend ScalarLanes operator>>(const ScalarLanes &a, const ScalarLanes &s){
+        return {a.lane[0] >> s.lane[0], a.lane[1] >> s.lane[1], a.lane[2] >> s.lane[2], a.lane[3] >> s.lane[3]};
+    }
+    friend ScalarLanes operator<<(const ScalarLanes &a, const ScalarLanes &s){
+        return {a.lane[0] << s.lane[0], a.lane[1] << s.lane[1], a.lane[2] << s.lane[2], a.lane[3] << s.lane[3]};
+    }
+};
+
+// Cells whose neighbour one step along (sign * direction) is a playable cell
+constexpr std::array<Bitboard, 4> buildStepSources(int sign){
+    std::array<Bitboard, 4> masks{};
+    const int dirs[4][2] = {{1, 0}, {0, 1}, {1, 1}, {1, -1}};
+    for(int d = 0; d < 4; d++){
+        for(int r = 0; r < BOARD_SIZE; r++){
+            for(int c = 0; c < BOARD_SIZE; c++){
+                int nr = r + sign * dirs[d][0];
+                int nc = c + sign * dirs[d][1];
+                if(nr < 0 || nr >= BOARD_SIZE || nc < 0 || nc >= BOARD_SIZE || !isPlayableCell(nr, nc)) continue;
+                masks[d] |= cellBit(r, c);
+            }
+        }
+    }
+    return masks;
+}
+
+constexpr std::array<Bitboard, 4> FORWARD_SOURCES = buildStepSources(1);
+constexpr std::array<Bitboard, 4> BACKWARD_SOURCES = buildStepSources(-1);
+
+constexpr Bitboard buildPlayableCells(){
+    Bitboard mask = 0;
+    for(int i = 0; i < NUM_PLAYABLE_CELLS; i++) mask |= Bitboard(1) << i;
+    return mask;
+}
+
+constexpr Bitboard PLAYABLE_CELLS = buildPlayableCells();
+
+// The 2x2 block evaluateMove() gives its small centre bonus to
+constexpr Bitboard buildCentreCells(){
+    Bitboard mask = 0;
+    for(int r = BOARD_SIZE / 2 - 1; r <= BOARD_SIZE / 2; r++){
+        for(int c = BOARD_SIZE / 2 - 1; c <= BOARD_SIZE / 2; c++) mask |= cellBit(r, c);
+    }
+    return mask;
+}
+
+constexpr Bitboard CENTRE_CELLS = buildCentreCells();
+
+// Per direction, the cells where a mark would score each of evaluateMove()'s patterns
+template<class Lanes>
+struct PatternMasks {
+    Lanes win;
+    Lanes openTwo;      // WIN_LENGTH - 1 in a row, open at both ends
+    Lanes openOne;      // WIN_LENGTH - 1 in a row, open at one end
+    Lanes openShort;    // WIN_LENGTH - 2 in a row, open at both ends
+};
+
+// Walks all directions in both senses for the whole board at once. forwardRun[k]
+// holds the cells followed by k own marks, forwardOpen those whose run then
+// reaches an empty cell within WIN_LENGTH - 1 steps; likewise backwards.
+template<class Lanes>
+inline __attribute__((always_inline)) void findPatterns(Bitboard own, Bitboard empty, PatternMasks<Lanes> &patterns){
+    const Lanes zero = {0, 0, 0, 0};
+    const Lanes step = {BOARD_SIZE, 1, BOARD_SIZE + 1, BOARD_SIZE - 1};
+    const Lanes forwardSources = {FORWARD_SOURCES[0], FORWARD_SOURCES[1], FORWARD_SOURCES[2], FORWARD_SOURCES[3]};
+    const Lanes backwardSources = {BACKWARD_SOURCES[0], BACKWARD_SOURCES[1], BACKWARD_SOURCES[2], BACKWARD_SOURCES[3]};
+    const Lanes ownLanes = {own, own, own, own};
+    const Lanes emptyLanes = {empty, empty, empty, empty};
+
+    Lanes forwardRun[WIN_LENGTH + 1], backwardRun[WIN_LENGTH + 1];
+    forwardRun[0] = backwardRun[0] = ~zero;
+    forwardRun[WIN_LENGTH] = backwardRun[WIN_LENGTH] = zero;
+    Lanes forwardOpen = zero, backwardOpen = zero;
+    Lanes forwardEmpty = (emptyLanes >> step) & forwardSources;
+    Lanes backwardEmpty = (emptyLanes << step) & backwardSources;
+#pragma GCC unroll 16
+    for(int k = 1; k < WIN_LENGTH; k++){
+        forwardOpen = forwardOpen | (forwardRun[k - 1] & forwardEmpty);
+        backwardOpen = backwardOpen | (backwardRun[k - 1] & backwardEmpty);
+        forwardRun[k] = ((forwardRun[k - 1] & ownLanes) >> step) & forwardSources;
+        backwardRun[k] = ((backwardRun[k - 1] & ownLanes) << step) & backwardSources;
+        forwardEmpty = (forwardEmpty >> step) & forwardSources;
+        backwardEmpty = (backwardEmpty << step) & backwardSources;
+    }
+
+    // Cells with exactly k own marks on that side
+    Lanes forwardExact[WIN_LENGTH], backwardExact[WIN_LENGTH];
+#pragma GCC unroll 16
+    for(int k = 0; k < WIN_LENGTH; k++){
+        forwardExact[k] = forwardRun[k] & ~forwardRun[k + 1];
+        backwardExact[k] = backwardRun[k] & ~backwardRun[k + 1];
+    }
+
+    patterns.win = zero;
+#pragma GCC unroll 16
+    for(int a = 0; a < WIN_LENGTH; a++){
+        patterns.win = patterns.win | (forwardRun[a] & backwardRun[WIN_LENGTH - 1 - a]);
+    }
+    const Lanes bothOpen = forwardOpen & backwardOpen;
+    Lanes almost = zero, shorter = zero;
+#pragma GCC unroll 16
+    for(int a = 0; a <= WIN_LENGTH - 2; a++) almost = almost | (forwardExact[a] & backwardExact[WIN_LENGTH - 2 - a]);
+#pragma GCC unroll 16
+    for(int a = 0; a <= WIN_LENGTH - 3; a++) shorter = shorter | (forwardExact[a] & backwardExact[WIN_LENGTH - 3 - a]);
+    patterns.openTwo = almost & bothOpen;
+    patterns.openOne = almost & (forwardOpen | backwardOpen) & ~bothOpen;
+    patterns.openShort = shorter & bothOpen;
+}
+
+template<class Lanes>
+inline __attribute__((always_inline)) void scoreCells(Bitboard own, Bitboard empty, const int *cells, int count,
+                                                      int *scores){
+    PatternMasks<Lanes> patterns;
+    findPatterns<Lanes>(own, empty, patterns);
+    for(int i = 0; i < count; i++){
+        const int cell = cells[i];
+        int score = (CENTRE_CELLS >> cell) & 1 ? 2 : 0;
+        // The patterns exclude each other within a direction, so their weights simply add up
+        for(int d = 0; d < 4; d++){
+            score += (int)((patterns.win[d] >> cell) & 1) * score_win
+                   + (int)((patterns.openTwo[d] >> cell) & 1) * thr_tw
+                   + (int)((patterns.openOne[d] >> cell) & 1) * thr_on
+                   + (int)((patterns.openShort[d] >> cell) & 1) * no_op;
+        }
+        scores[i] = score;
+    }
+}
+
+typedef void (*ScoreKernel)(Bitboard own, Bitboard empty, const int *cells, int count, int *scores);
+
+void scoreCellsScalar(Bitboard own, Bitboard empty, const int *cells, int count, int *scores){
+    scoreCells<ScalarLanes>(own, empty, cells, count, scores);
+}
+
+#ifdef MOVESCORE_X86_KERNELS
+// Same source as the scalar kernel; the vector type becomes one AVX2 register or two SSE ones
+__attribute__((target("avx2")))
+void scoreCellsAvx2(Bitboard own, Bitboard empty, const int *cells, int count, int *scores){
+    scoreCells<VectorLanes>(own, empty, cells, count, scores);
+}
+
+__attribute__((target("sse4.1")))
+void scoreCellsSse41(Bitboard own, Bitboard empty, const int *cells, int count, int *scores){
+    scoreCells<VectorLanes>(own, empty, cells, count, scores);
+}
+
+bool hasAvx2(){
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+bool hasSse41(){
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1");
+}
+#endif
+
+bool always(){
+    return true;
+}
+
+struct KernelChoice {
+    const char *name;
+    bool (*supported)();
+    ScoreKernel run;
+};
+
+// Fastest first
+const KernelChoice KERNELS[] = {
+#ifdef MOVESCORE_X86_KERNELS
+    {"avx2", hasAvx2, scoreCellsAvx2},
+    {"sse4.1", hasSse41, scoreCellsSse41},
+#endif
+    {"scalar", always, scoreCellsScalar},
+};
+
+const KernelChoice *pickKernel(){
+    for(const KernelChoice &kernel : KERNELS){
+        if(kernel.supported()) return &kernel;
+    }
+    return &KERNELS[0];
+}
+
+const KernelChoice *activeKernel = pickKernel();
+
+} // namespace
+
+void evaluateMoves(const int *products, int count, int player, int *scores){
+    const Bitboard occupied = occupiedBits();
+    int cells[MAX_CANDIDATES] = {};
+    int cellScores[MAX_CANDIDATES] = {};
+    int valid = 0;
+    for(int i = 0; i < count; i++){
+        int cell = productCell(products[i]);
+        if(cell >= 0 && !(occupied & (Bitboard(1) << cell))) cells[valid++] = cell;
+    }
+    activeKernel->run(playerBits[player], PLAYABLE_CELLS & ~occupied, cells, valid, cellScores);
+    valid = 0;
+    for(int i = 0; i < count; i++){
+        int cell = productCell(products[i]);
+        if(cell >= 0 && !(occupied & (Bitboard(1) << cell))) scores[i] = cellScores[valid++];
+        else scores[i] = std::numeric_limits<int>::min();
+    }
+}
+
+std::vector<std::string> moveScoreKernels(){
+    std::vector<std::string> names;
+    for(const KernelChoice &kernel : KERNELS){
+        if(kernel.supported()) names.push_back(kernel.name);
+    }
+    return names;
+}
+
+bool useMoveScoreKernel(const std::string &name){
+    for(const KernelChoice &kernel : KERNELS){
+        if(name == kernel.name && kernel.supported()){
+            activeKernel = &kernel;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *moveScoreKernel(){
+    return activeKernel->name;
+}
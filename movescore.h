@@ -0,0 +1,19 @@
+// movescore.h
+#ifndef MOVESCORE_H
+#define MOVESCORE_H
+
+#include <string>
+#include <vector>
+
+// evaluateMove() for several products at once: one pass over the board finds
+// the line patterns of every cell, then each product reads off its own cell.
+// Gives INT_MIN for products that are not valid moves, like evaluateMove().
+void evaluateMoves(const int *products, int count, int player, int *scores);
+
+// Kernels behind evaluateMoves() that this CPU can run, fastest first; the
+// first is used unless useMoveScoreKernel() picks another
+std::vector<std::string> moveScoreKernels();
+bool useMoveScoreKernel(const std::string &name);
+const char *moveScoreKernel();
+
+#endif
@@ -0,0 +1,100 @@
+// movestack.h
+#ifndef MOVESTACK_H
+#define MOVESTACK_H
+
+#include <cstdint>
+#include "position.h"
+#include "lineeval.h"
+
+// Every move can be followed by at most one pass before the game is drawn
+const int MAX_GAME_PLIES = 2 * NUM_CELLS;
+
+struct MoveEntry {
+    int8_t cell;            // -1 for a pass
+    int8_t factor;          // factor played, 0 for a pass
+    int8_t previousFactor;
+    int8_t previousSide;    // the player who made the move
+};
+
+// A position and the plies that led to it. make/pass/unmake are O(1) and
+// allocation free, so the search uses it for every node; undone plies stay
+// above the top for redo until a different ply is made. The win lines are
+// scored along the way, so evaluate() is a single read.
+class MoveStack {
+public:
+    MoveStack(){
+        clearPosition(pos, MIN_FACTOR, HUMAN_PLAYER);
+        reset(pos);
+    }
+    explicit MoveStack(const Position &start){ reset(start); }
+
+    void reset(const Position &start){
+        pos = start;
+        depth = top = 0;
+        lines.reset(pos.bits[HUMAN_PLAYER], pos.bits[COMPUTER_PLAYER]);
+    }
+
+    const Position &position() const { return pos; }
+    int size() const { return depth; }
+    const MoveEntry &at(int index) const { return entries[index]; }
+    const MoveEntry &last() const { return entries[depth - 1]; }
+    // Same as evaluatePosition(position())
+    int evaluate() const { return lines.score(pos.sideToMove); }
+
+    // Plays a legal factor for the side to move and returns the marked cell
+    int make(int factor){
+        MoveEntry &entry = entries[depth++];
+        entry.previousFactor = (int8_t)pos.activeFactor;
+        entry.previousSide = (int8_t)pos.sideToMove;
+        entry.factor = (int8_t)factor;
+        entry.cell = (int8_t)makeMove(pos, factor);
+        lines.mark(entry.cell, entry.previousSide);
+        top = depth;
+        return entry.cell;
+    }
+
+    void pass(){
+        MoveEntry &entry = entries[depth++];
+        entry.previousFactor = (int8_t)pos.activeFactor;
+        entry.previousSide = (int8_t)pos.sideToMove;
+        entry.factor = 0;
+        entry.cell = -1;
+        makePass(pos);
+        top = depth;
+    }
+
+    void unmake(){
+        const MoveEntry &entry = entries[--depth];
+        if(entry.cell < 0){
+            makePass(pos);
+        }else{
+            unmakeMove(pos, entry.cell, entry.previousFactor);
+            lines.unmark(entry.cell, entry.previousSide);
+        }
+    }
+
+    bool canUndo() const { return depth > 0; }
+    bool canRedo() const { return depth < top; }
+    bool undo(){
+        if(!canUndo()) return false;
+        unmake();
+        return true;
+    }
+    // Replays the next undone ply; the entry is still valid since nothing else was made
+    bool redo(){
+        if(!canRedo()) return false;
+        const MoveEntry &entry = entries[depth++];
+        if(entry.cell < 0) makePass(pos);
+        else lines.mark(makeMove(pos, entry.factor), entry.previousSide);
+        return true;
+    }
+
+private:
+    Position pos;
+    LineEvaluator lines;
+    MoveEntry entries[MAX_GAME_PLIES];
+    int depth = 0;
+    int top = 0;
+};
+
+#endif
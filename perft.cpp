@@ -0,0 +1,305 @@
+// Perft: counts the leaves of the move tree to a fixed depth under the real
+// rules. A pass is a ply of its own; wins, dead positions and two stuck
+// players end a line early. --check recounts with the game's own functions.
+#include "game.h"
+#include "board.h"
+#include "utils.h"
+#include "gamecore.h"
+#include "movescore.h"
+#include "movestack.h"
+#include "search.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int PASS_MOVE = 0;
+
+struct PerftOptions {
+    std::string from = SAVE_FILENAME;
+    int factor = 0;                 // start from an empty board with this factor instead
+    int side = HUMAN_PLAYER;
+    int depth = 5;
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    bool divide = false;
+    bool check = false;
+};
+
+struct Child {
+    Position pos;
+    int factor;                     // PASS_MOVE for a pass
+    bool terminal;                  // won, dead or nobody can move
+};
+
+// --check: liveLines after every make and unmake against a recount from the board
+bool checkLines = false;
+std::atomic<uint64_t> lineChecks(0);
+std::atomic<uint64_t> lineMismatches(0);
+
+bool liveLinesMatch(const Bitboard bits[3], const int lines[3]){
+    return lines[HUMAN_PLAYER] == countOpenLines(bits[COMPUTER_PLAYER])
+        && lines[COMPUTER_PLAYER] == countOpenLines(bits[HUMAN_PLAYER]);
+}
+
+void checkLiveLines(const Position &parent, const Position &child, int cell){
+    Position undone = child;
+    unmakeMove(undone, cell, parent.activeFactor);
+    bool match = liveLinesMatch(child.bits, child.liveLines)
+              && undone.liveLines[HUMAN_PLAYER] == parent.liveLines[HUMAN_PLAYER]
+              && undone.liveLines[COMPUTER_PLAYER] == parent.liveLines[COMPUTER_PLAYER];
+    lineChecks.fetch_add(1, std::memory_order_relaxed);
+    if(!match) lineMismatches.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Successors under the game rules; empty when neither player can move
+int expand(const Position &pos, Child out[MAX_FACTOR]){
+    const Bitboard legal = legalMoves(pos);
+    if(!legal){
+        out[0].pos = pos;
+        makePass(out[0].pos);
+        if(!legalMoves(out[0].pos)) return 0;
+        out[0].factor = PASS_MOVE;
+        out[0].terminal = false;
+        return 1;
+    }
+    int count = 0;
+    const int side = pos.sideToMove;
+    for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+        if(!(legal & (Bitboard(1) << MOVE_CELL[pos.activeFactor][f]))) continue;
+        Child &child = out[count++];
+        child.pos = pos;
+        int cell = makeMove(child.pos, f);
+        if(checkLines) checkLiveLines(pos, child.pos, cell);
+        child.factor = f;
+        child.terminal = wonAt(child.pos, cell, side) || isDead(child.pos);
+    }
+    return count;
+}
+
+uint64_t perft(const Position &pos, int depth, uint64_t &nodes){
+    Child children[MAX_FACTOR];
+    int count = expand(pos, children);
+    nodes += count;
+    if(depth == 1) return count;
+    uint64_t leaves = 0;
+    for(int i = 0; i < count; i++){
+        if(!children[i].terminal) leaves += perft(children[i].pos, depth - 1, nodes);
+    }
+    return leaves;
+}
+
+std::vector<std::string> scoreKernels;
+uint64_t scoredMoves = 0;
+uint64_t scoreMismatches = 0;
+
+// Every evaluateMoves() kernel against evaluateMove() for both players' moves at this node
+void checkMoveScores(int activeFactor){
+    int products[MAX_FACTOR];
+    int count = 0;
+    for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++) products[count++] = activeFactor * f;
+    for(int player = HUMAN_PLAYER; player <= COMPUTER_PLAYER; player++){
+        int expected[MAX_FACTOR];
+        for(int i = 0; i < count; i++) expected[i] = evaluateMove(products[i], player);
+        for(const std::string &kernel : scoreKernels){
+            int scores[MAX_FACTOR];
+            useMoveScoreKernel(kernel);
+            evaluateMoves(products, count, player, scores);
+            for(int i = 0; i < count; i++) scoreMismatches += scores[i] != expected[i];
+            scoredMoves += count;
+        }
+    }
+    useMoveScoreKernel(scoreKernels[0]);
+}
+
+// Same count through canPlayerMove(), isValidMove(), wouldWin() and the board globals
+uint64_t boardPerft(int activeFactor, int side, int depth){
+    if(depth == 0) return 1;
+    const int opponent = side == HUMAN_PLAYER ? COMPUTER_PLAYER : HUMAN_PLAYER;
+    if(!canPlayerMove(activeFactor)){
+        // Both players share the active factor, so after a pass the opponent is
+        // stuck as well and the game is drawn, exactly like playGame() finds
+        return 0;
+    }
+    checkMoveScores(activeFactor);
+    uint64_t leaves = 0;
+    for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+        int product = activeFactor * f;
+        if(!isValidMove(product)) continue;
+        bool won = wouldWin(product, side);
+        const Bitboard savedBits[3] = {playerBits[0], playerBits[1], playerBits[2]};
+        const int savedLines[3] = {liveLines[0], liveLines[1], liveLines[2]};
+        placeMark(productCell(product), side);
+        lineChecks++;
+        if(!liveLinesMatch(playerBits, liveLines)) lineMismatches++;
+        if(won || isDeadPosition()) leaves += depth == 1;
+        else leaves += boardPerft(f, opponent, depth - 1);
+        for(int p = 0; p < 3; p++){
+            playerBits[p] = savedBits[p];
+            liveLines[p] = savedLines[p];
+        }
+    }
+    return leaves;
+}
+
+uint64_t evaluations = 0;
+uint64_t evaluationMismatches = 0;
+
+void checkEvaluation(const MoveStack &stack){
+    evaluations++;
+    if(stack.evaluate() != evaluatePosition(stack.position())) evaluationMismatches++;
+}
+
+// Same count through the search's MoveStack, its incremental line scores
+// compared with a full evaluation after every make, unmake and redo
+uint64_t stackPerft(MoveStack &stack, int depth){
+    const Bitboard legal = legalMoves(stack.position());
+    if(!legal){
+        uint64_t leaves = 0;
+        stack.pass();
+        if(legalMoves(stack.position())){
+            checkEvaluation(stack);
+            leaves = depth == 1 ? 1 : stackPerft(stack, depth - 1);
+        }
+        stack.unmake();
+        checkEvaluation(stack);
+        return leaves;
+    }
+    uint64_t leaves = 0;
+    const int side = stack.position().sideToMove;
+    for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+        if(!(legal & (Bitboard(1) << MOVE_CELL[stack.position().activeFactor][f]))) continue;
+        int cell = stack.make(f);
+        checkEvaluation(stack);
+        bool terminal = wonAt(stack.position(), cell, side) || isDead(stack.position());
+        if(depth == 1) leaves++;
+        else if(!terminal) leaves += stackPerft(stack, depth - 1);
+        stack.unmake();
+        checkEvaluation(stack);
+        stack.redo();
+        checkEvaluation(stack);
+        stack.unmake();
+        checkEvaluation(stack);
+    }
+    return leaves;
+}
+
+// Root moves split into one task per grandchild so threads stay busy with only nine root moves
+struct Task {
+    int root;                       // index into the root children
+    Position pos;
+    int depth;                      // plies left below `pos`
+    bool leaf;                      // counts as exactly one leaf
+};
+
+bool parseOptions(int argc, char **argv, PerftOptions &options){
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "--divide"){ options.divide = true; continue; }
+        if(arg == "--check"){ options.check = true; continue; }
+        if(i + 1 >= argc) return false;
+        const char *value = argv[++i];
+        if(arg == "--from") options.from = value;
+        else if(arg == "--factor") options.factor = std::atoi(value);
+        else if(arg == "--side") options.side = std::string(value) == "computer" ? COMPUTER_PLAYER : HUMAN_PLAYER;
+        else if(arg == "--depth") options.depth = std::atoi(value);
+        else if(arg == "--threads") options.threads = std::atoi(value);
+        else return false;
+    }
+    return options.depth > 0 && options.threads > 0 && (options.factor == 0 || isFactor(options.factor));
+}
+
+} // namespace
+
+int main(int argc, char **argv){
+    PerftOptions options;
+    if(!parseOptions(argc, argv, options)){
+        std::fprintf(stderr, "Usage: %s [--from save_file | --factor n [--side human|computer]] [--depth n]\n"
+                             "          [--threads n] [--divide] [--check]\n", argv[0]);
+        return 1;
+    }
+    Position root;
+    if(options.factor) clearPosition(root, options.factor, options.side);
+    else if(!readSaveFile(options.from, root)){
+        std::fprintf(stderr, "Could not read position from %s\n", options.from.c_str());
+        return 1;
+    }
+
+    checkLines = options.check;
+    auto begin = std::chrono::steady_clock::now();
+    Child rootChildren[MAX_FACTOR];
+    const int rootCount = expand(root, rootChildren);
+    std::vector<Task> tasks;
+    uint64_t nodes = rootCount;
+    for(int i = 0; i < rootCount; i++){
+        const Child &child = rootChildren[i];
+        if(options.depth == 1) tasks.push_back({i, child.pos, 0, true});
+        else if(child.terminal) continue;
+        else if(options.depth == 2) tasks.push_back({i, child.pos, 1, false});
+        else{
+            Child grandchildren[MAX_FACTOR];
+            int count = expand(child.pos, grandchildren);
+            nodes += count;
+            for(int j = 0; j < count; j++){
+                if(!grandchildren[j].terminal) tasks.push_back({i, grandchildren[j].pos, options.depth - 2, false});
+            }
+        }
+    }
+
+    std::vector<std::atomic<uint64_t>> perRoot(MAX_FACTOR);
+    std::atomic<uint64_t> totalNodes(nodes);
+    std::atomic<size_t> nextTask(0);
+    std::vector<std::thread> workers;
+    for(int t = 0; t < options.threads; t++){
+        workers.emplace_back([&](){
+            uint64_t workerNodes = 0;
+            for(size_t i = nextTask++; i < tasks.size(); i = nextTask++){
+                const Task &task = tasks[i];
+                perRoot[task.root] += task.leaf ? 1 : perft(task.pos, task.depth, workerNodes);
+            }
+            totalNodes += workerNodes;
+        });
+    }
+    for(auto &worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    uint64_t leaves = 0;
+    for(int i = 0; i < rootCount; i++){
+        leaves += perRoot[i];
+        if(options.divide){
+            if(rootChildren[i].factor == PASS_MOVE) std::printf("pass: %llu\n", (unsigned long long)perRoot[i].load());
+            else std::printf("%d: %llu\n", rootChildren[i].factor, (unsigned long long)perRoot[i].load());
+        }
+    }
+    std::printf("Depth %d: %llu leaves, %llu nodes in %.3f s (%.0f nodes/sec, %d threads)\n",
+                options.depth, (unsigned long long)leaves, (unsigned long long)totalNodes.load(), seconds,
+                seconds > 0 ? totalNodes / seconds : 0.0, options.threads);
+
+    if(options.check){
+        resetGameMarkings();
+        for(int p = HUMAN_PLAYER; p <= COMPUTER_PLAYER; p++){
+            for(Bitboard b = root.bits[p]; b; b &= b - 1) placeMark(lowestCell(b), p);
+        }
+        scoreKernels = moveScoreKernels();
+        uint64_t expected = boardPerft(root.activeFactor, root.sideToMove, options.depth);
+        std::printf("Game rules: %llu leaves, %s\n", (unsigned long long)expected,
+                    expected == leaves ? "match" : "MISMATCH");
+        std::string kernels;
+        for(const std::string &kernel : scoreKernels) kernels += (kernels.empty() ? "" : ", ") + kernel;
+        std::printf("Move scores (%s): %llu scored, %s\n", kernels.c_str(), (unsigned long long)scoredMoves,
+                    scoreMismatches ? "MISMATCH" : "match");
+        std::printf("Live lines: %llu marks recounted, %s\n", (unsigned long long)lineChecks.load(),
+                    lineMismatches ? "MISMATCH" : "match");
+        MoveStack stack(root);
+        uint64_t stackLeaves = stackPerft(stack, options.depth);
+        const bool evaluationsMatch = stackLeaves == leaves && !evaluationMismatches;
+        std::printf("Line scores: %llu evaluations over %llu leaves, %s\n", (unsigned long long)evaluations,
+                    (unsigned long long)stackLeaves, evaluationsMatch ? "match" : "MISMATCH");
+        if(expected != leaves || scoreMismatches || lineMismatches || !evaluationsMatch) return 2;
+    }
+    return 0;
+}
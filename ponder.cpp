@@ -0,0 +1,73 @@
+#include "ponder.h"
+
+namespace {
+
+const int PONDER_TIME_MS = 24 * 60 * 60 * 1000;   // only cancel() ends a pondering search
+
+} // namespace
+
+Ponderer::~Ponderer(){
+    stop();
+}
+
+void Ponderer::start(const Position &pos, const SearchLimits &limits){
+    stop();
+    replyCount = 0;
+    const Bitboard legal = legalMoves(pos);
+    for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+        if(!(legal & (Bitboard(1) << MOVE_CELL[pos.activeFactor][f]))) continue;
+        Reply &reply = replies[replyCount];
+        reply.pos = pos;
+        int cell = makeMove(reply.pos, f);
+        if(wonAt(reply.pos, cell, pos.sideToMove) || isDead(reply.pos)) continue;  // game over, nothing to answer
+        reply.key = reply.pos.key;
+        reply.result = SearchResult();
+        reply.searched = false;
+        reply.finished = false;
+        replyCount++;
+    }
+    if(replyCount == 0) return;
+    cancel.store(false);
+    worker = std::thread(&Ponderer::run, this, limits);
+}
+
+void Ponderer::stop(){
+    if(!worker.joinable()) return;
+    cancel.store(true);
+    worker.join();
+}
+
+bool Ponderer::lookup(uint64_t key, SearchResult &result) const {
+    if(worker.joinable()) return false;
+    for(int i = 0; i < replyCount; i++){
+        if(replies[i].key == key && replies[i].searched){
+            result = replies[i].result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Deepens every reply by one ply per round; the table keeps the shallower
+// work, so each round costs little more than its last iteration
+void Ponderer::run(SearchLimits limits){
+    const int maxDepth = limits.maxDepth;
+    limits.timeMs = PONDER_TIME_MS;
+    limits.cancel = &cancel;
+    for(int depth = 1; depth <= maxDepth; depth++){
+        bool anyOpen = false;
+        for(int i = 0; i < replyCount; i++){
+            Reply &reply = replies[i];
+            if(reply.finished) continue;
+            limits.maxDepth = depth;
+            SearchResult result = searchBestFactor(reply.pos, limits);
+            if(cancel.load()) return;
+            reply.result = result;
+            reply.searched = true;
+            int emptyCells = NUM_CELLS - popCount(occupied(reply.pos));
+            reply.finished = result.factor < 0 || isWinScore(result.score) || depth >= emptyCells;
+            anyOpen = anyOpen || !reply.finished;
+        }
+        if(!anyOpen) return;
+    }
+}
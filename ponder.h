@@ -0,0 +1,45 @@
+// ponder.h
+#ifndef PONDER_H
+#define PONDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "search.h"
+
+// Searches the reply to every legal move of the side to move on a background
+// thread while it is thinking, one depth at a time across all replies, so
+// whichever move is played has a result ready.
+class Ponderer {
+public:
+    Ponderer() = default;
+    ~Ponderer();
+    Ponderer(const Ponderer &) = delete;
+    Ponderer &operator=(const Ponderer &) = delete;
+
+    // `limits.timeMs` is ignored; pondering runs until stop()
+    void start(const Position &pos, const SearchLimits &limits);
+    // Cancels the search and waits for the thread; safe to call when idle
+    void stop();
+    bool isRunning() const { return worker.joinable(); }
+    // Deepest finished result for the position after a move; only valid after stop()
+    bool lookup(uint64_t key, SearchResult &result) const;
+
+private:
+    struct Reply {
+        uint64_t key;
+        Position pos;
+        SearchResult result;
+        bool searched;
+        bool finished;    // decided or searched to the end of the game
+    };
+
+    void run(SearchLimits limits);
+
+    Reply replies[MAX_FACTOR];
+    int replyCount = 0;
+    std::thread worker;
+    std::atomic<bool> cancel{false};
+};
+
+#endif
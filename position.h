@@ -0,0 +1,116 @@
+// position.h
+#ifndef POSITION_H
+#define POSITION_H
+
+#include "bitboard.h"
+#include "movegen.h"
+#include "zobrist.h"
+
+// Self-contained game position used by the AI search
+struct Position {
+    Bitboard bits[3];     // indexed by HUMAN_PLAYER / COMPUTER_PLAYER, slot 0 unused
+    int liveLines[3];     // lines each player can still complete
+    int activeFactor;
+    int sideToMove;       // HUMAN_PLAYER or COMPUTER_PLAYER
+    uint64_t key;         // Zobrist hash, kept up to date by every make/unmake
+};
+
+inline int opponentOf(int player){
+    return player == HUMAN_PLAYER ? COMPUTER_PLAYER : HUMAN_PLAYER;
+}
+
+// Full Zobrist hash of a position, for positions built without make/unmake
+inline uint64_t computeKey(const Position &pos){
+    uint64_t key = ZOBRIST.factor[pos.activeFactor];
+    if(pos.sideToMove == COMPUTER_PLAYER) key ^= ZOBRIST.computerToMove;
+    for(int p = HUMAN_PLAYER; p <= COMPUTER_PLAYER; p++){
+        for(Bitboard b = pos.bits[p]; b; b &= b - 1) key ^= ZOBRIST.cell[p][lowestCell(b)];
+    }
+    return key;
+}
+
+inline void clearPosition(Position &pos, int activeFactor, int sideToMove){
+    pos.bits[0] = pos.bits[HUMAN_PLAYER] = pos.bits[COMPUTER_PLAYER] = 0;
+    pos.liveLines[0] = 0;
+    pos.liveLines[HUMAN_PLAYER] = pos.liveLines[COMPUTER_PLAYER] = NUM_WIN_LINES;
+    pos.activeFactor = activeFactor;
+    pos.sideToMove = sideToMove;
+    pos.key = computeKey(pos);
+}
+
+inline Bitboard occupied(const Position &pos){
+    return pos.bits[HUMAN_PLAYER] | pos.bits[COMPUTER_PLAYER];
+}
+
+inline Bitboard legalMoves(const Position &pos){
+    return legalMoves(pos.activeFactor, occupied(pos));
+}
+
+inline bool isLegalFactor(const Position &pos, int factor){
+    return isFactor(factor) && (legalMoves(pos) & (Bitboard(1) << MOVE_CELL[pos.activeFactor][factor]));
+}
+
+// Lines holding none of `blockers`, counted from scratch; a player's
+// liveLines is this count for the opponent's marks
+inline int countOpenLines(Bitboard blockers){
+    int count = 0;
+    for(Bitboard line : WIN_LINES) count += !(blockers & line);
+    return count;
+}
+
+inline bool isDead(const Position &pos){
+    return pos.liveLines[HUMAN_PLAYER] == 0 && pos.liveLines[COMPUTER_PLAYER] == 0;
+}
+
+// Sets a player's bit and retires the opponent lines it blocks: those the
+// player had no mark in yet, whatever the opponent has there
+inline void setMark(Position &pos, int cell, int player){
+    int opponent = opponentOf(player);
+    const CellLines &lines = CELL_LINES[cell];
+    for(int k = 0; k < lines.count; k++){
+        if(!(pos.bits[player] & lines.masks[k])) pos.liveLines[opponent]--;
+    }
+    pos.bits[player] |= Bitboard(1) << cell;
+    pos.key ^= ZOBRIST.cell[player][cell];
+}
+
+// Exact inverse of setMark()
+inline void clearMark(Position &pos, int cell, int player){
+    int opponent = opponentOf(player);
+    pos.bits[player] &= ~(Bitboard(1) << cell);
+    pos.key ^= ZOBRIST.cell[player][cell];
+    const CellLines &lines = CELL_LINES[cell];
+    for(int k = 0; k < lines.count; k++){
+        if(!(pos.bits[player] & lines.masks[k])) pos.liveLines[opponent]++;
+    }
+}
+
+// Plays a legal factor for the side to move and returns the marked cell
+inline int makeMove(Position &pos, int factor){
+    int cell = MOVE_CELL[pos.activeFactor][factor];
+    setMark(pos, cell, pos.sideToMove);
+    pos.key ^= ZOBRIST.factor[pos.activeFactor] ^ ZOBRIST.factor[factor] ^ ZOBRIST.computerToMove;
+    pos.activeFactor = factor;
+    pos.sideToMove = opponentOf(pos.sideToMove);
+    return cell;
+}
+
+inline void unmakeMove(Position &pos, int cell, int previousFactor){
+    pos.key ^= ZOBRIST.factor[pos.activeFactor] ^ ZOBRIST.factor[previousFactor] ^ ZOBRIST.computerToMove;
+    pos.sideToMove = opponentOf(pos.sideToMove);
+    pos.activeFactor = previousFactor;
+    clearMark(pos, cell, pos.sideToMove);
+}
+
+// A pass hands the turn over without changing the active factor
+inline void makePass(Position &pos){
+    pos.sideToMove = opponentOf(pos.sideToMove);
+    pos.key ^= ZOBRIST.computerToMove;
+}
+
+// True if the mark on `cell` completed a line for its owner
+inline bool wonAt(const Position &pos, int cell, int player){
+    return hasWinLineThrough(pos.bits[player], cell);
+}
+
+#endif
@@ -0,0 +1,238 @@
+#include "savefile.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+const char SAVE_MAGIC[8] = {'M', 'G', 'S', 'A', 'V', 'E', 'S', '1'};
+const uint32_t SAVE_VERSION = 1;
+
+struct SaveHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t recordSize;
+    uint32_t checksum;       // over the fields above
+};
+
+struct SaveRecord {
+    char name[SAVE_NAME_LENGTH + 1];
+    uint8_t board[PACKED_BOARD_BYTES];   // owner of each cell, 2 bits, cell 0 in the low bits
+    uint8_t activeFactor;
+    uint8_t sideToMove;
+    uint8_t used;
+    int64_t savedAt;
+    uint32_t checksum;       // over everything before it
+    uint32_t reserved;
+};
+
+bool isBlank(char c){
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Reads exactly `count` non-negative integers from [p, end) and nothing else
+bool readInts(const char *p, const char *end, int *out, int count){
+    for(int i = 0; i < count; i++){
+        while(p < end && isBlank(*p)) p++;
+        if(p == end || *p < '0' || *p > '9') return false;
+        int value = 0;
+        for(; p < end && *p >= '0' && *p <= '9'; p++){
+            value = value * 10 + (*p - '0');
+            if(value > 1000) return false;
+        }
+        out[i] = value;
+    }
+    while(p < end && isBlank(*p)) p++;
+    return p == end;
+}
+
+// End of the line starting at p, and the start of the one after it
+const char *lineEnd(const char *p, const char *end){
+    const char *newline = (const char *)std::memchr(p, '\n', end - p);
+    return newline ? newline : end;
+}
+
+const char *nextLine(const char *p, const char *end){
+    return p < end ? p + 1 : end;
+}
+
+// FNV-1a
+uint32_t checksum(const void *data, size_t length){
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < length; i++){
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+SaveHeader makeHeader(){
+    SaveHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SAVE_MAGIC, sizeof(SAVE_MAGIC));
+    header.version = SAVE_VERSION;
+    header.slotCount = SAVE_SLOT_COUNT;
+    header.recordSize = sizeof(SaveRecord);
+    header.checksum = checksum(&header, offsetof(SaveHeader, checksum));
+    return header;
+}
+
+bool headerValid(const SaveHeader &header){
+    SaveHeader expected = makeHeader();
+    return std::memcmp(&header, &expected, sizeof(header)) == 0;
+}
+
+bool decodeRecord(const SaveRecord &record, SaveSlot &slot){
+    slot = SaveSlot();
+    if(!record.used) return true;
+    if(record.checksum != checksum(&record, offsetof(SaveRecord, checksum))) return false;
+    if(!unpackBoard(record.board, record.activeFactor, record.sideToMove, slot.pos)) return false;
+    slot.used = true;
+    slot.name.assign(record.name, strnlen(record.name, SAVE_NAME_LENGTH));
+    slot.savedAt = record.savedAt;
+    return true;
+}
+
+SaveRecord encodeRecord(const std::string &name, const Position &pos, int64_t savedAt){
+    SaveRecord record;
+    std::memset(&record, 0, sizeof(record));
+    std::strncpy(record.name, name.c_str(), SAVE_NAME_LENGTH);
+    packBoard(pos, record.board);
+    record.activeFactor = (uint8_t)pos.activeFactor;
+    record.sideToMove = (uint8_t)pos.sideToMove;
+    record.used = 1;
+    record.savedAt = savedAt;
+    record.checksum = checksum(&record, offsetof(SaveRecord, checksum));
+    return record;
+}
+
+bool readRecords(const std::string &path, SaveRecord records[SAVE_SLOT_COUNT]){
+    FILE *in = std::fopen(path.c_str(), "rb");
+    if(!in) return false;
+    SaveHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, in) == 1 && headerValid(header)
+           && std::fread(records, sizeof(SaveRecord), SAVE_SLOT_COUNT, in) == (size_t)SAVE_SLOT_COUNT;
+    std::fclose(in);
+    return ok;
+}
+
+} // namespace
+
+void packBoard(const Position &pos, uint8_t out[PACKED_BOARD_BYTES]){
+    std::memset(out, 0, PACKED_BOARD_BYTES);
+    for(int p = HUMAN_PLAYER; p <= COMPUTER_PLAYER; p++){
+        for(Bitboard b = pos.bits[p]; b; b &= b - 1){
+            int cell = lowestCell(b);
+            out[cell / 4] |= (uint8_t)(p << (cell % 4 * 2));
+        }
+    }
+}
+
+bool unpackBoard(const uint8_t in[PACKED_BOARD_BYTES], int activeFactor, int sideToMove, Position &pos){
+    if(!isFactor(activeFactor) || (sideToMove != HUMAN_PLAYER && sideToMove != COMPUTER_PLAYER)) return false;
+    clearPosition(pos, activeFactor, sideToMove);
+    for(int cell = 0; cell < NUM_CELLS; cell++){
+        int owner = (in[cell / 4] >> (cell % 4 * 2)) & 0x3;
+        if(owner > COMPUTER_PLAYER) return false;
+        if(owner != NO_PLAYER) setMark(pos, cell, owner);
+    }
+    return true;
+}
+
+bool readSaveSlots(const std::string &path, std::vector<SaveSlot> &slots){
+    SaveRecord records[SAVE_SLOT_COUNT];
+    slots.assign(SAVE_SLOT_COUNT, SaveSlot());
+    if(!readRecords(path, records)) return false;
+    for(int i = 0; i < SAVE_SLOT_COUNT; i++){
+        if(!decodeRecord(records[i], slots[i])) slots[i] = SaveSlot();
+    }
+    return true;
+}
+
+bool readSaveSlot(const std::string &path, int index, SaveSlot &slot){
+    if(index < 0 || index >= SAVE_SLOT_COUNT) return false;
+    FILE *in = std::fopen(path.c_str(), "rb");
+    if(!in) return false;
+    SaveHeader header;
+    SaveRecord record;
+    bool ok = std::fread(&header, sizeof(header), 1, in) == 1 && headerValid(header)
+           && std::fseek(in, (long)(sizeof(SaveHeader) + index * sizeof(SaveRecord)), SEEK_SET) == 0
+           && std::fread(&record, sizeof(record), 1, in) == 1;
+    std::fclose(in);
+    return ok && decodeRecord(record, slot) && slot.used;
+}
+
+bool writeSaveSlot(const std::string &path, int index, const std::string &name,
+                   const Position &pos, int64_t savedAt){
+    if(index < 0 || index >= SAVE_SLOT_COUNT) return false;
+    SaveRecord records[SAVE_SLOT_COUNT];
+    if(!readRecords(path, records)){
+        // Start afresh only when there is no file; one we cannot read may still
+        // hold other saves, so it is kept aside rather than written over
+        std::memset(records, 0, sizeof(records));
+        if(std::rename(path.c_str(), (path + ".bad").c_str()) != 0 && errno != ENOENT) return false;
+    }
+    records[index] = encodeRecord(name, pos, savedAt);
+
+    SaveHeader header = makeHeader();
+    std::string tempPath = path + ".tmp";
+    FILE *out = std::fopen(tempPath.c_str(), "wb");
+    if(!out) return false;
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1
+           && std::fwrite(records, sizeof(SaveRecord), SAVE_SLOT_COUNT, out) == (size_t)SAVE_SLOT_COUNT;
+    return replaceFile(out, ok, tempPath, path);
+}
+
+bool replaceFile(FILE *out, bool written, const std::string &tempPath, const std::string &path){
+    bool ok = written && std::fflush(out) == 0 && ::fsync(fileno(out)) == 0;
+    ok = (std::fclose(out) == 0) && ok;
+    if(!ok || std::rename(tempPath.c_str(), path.c_str()) != 0){
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    // The rename itself is only durable once the directory entry is on disk
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if(fd < 0) return false;
+    ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+TextParseResult parseTextPosition(const char *&cursor, const char *end, Position &pos){
+    const char *p = cursor;
+    while(p < end && (isBlank(*p) || *p == '\n')) p++;
+    if(p == end){
+        cursor = end;
+        return TEXT_END;
+    }
+
+    const char *eol = lineEnd(p, end);
+    int header[2];
+    bool valid = readInts(p, eol, header, 2) && isFactor(header[0]);
+    if(valid) clearPosition(pos, header[0], header[1] == 1 ? HUMAN_PLAYER : COMPUTER_PLAYER);
+    p = nextLine(eol, end);
+    for(int row = 0; row < BOARD_SIZE; row++){
+        if(p == end){
+            valid = false;
+            break;
+        }
+        eol = lineEnd(p, end);
+        int owners[BOARD_SIZE];
+        if(valid) valid = readInts(p, eol, owners, BOARD_SIZE);
+        for(int col = 0; valid && col < BOARD_SIZE; col++){
+            const int owner = owners[col];
+            if(owner > COMPUTER_PLAYER || (owner != NO_PLAYER && !isPlayableCell(row, col))) valid = false;
+            else if(owner != NO_PLAYER) setMark(pos, row * BOARD_SIZE + col, owner);
+        }
+        p = nextLine(eol, end);
+    }
+    cursor = p;
+    return valid ? TEXT_VALID : TEXT_INVALID;
+}
@@ -0,0 +1,59 @@
+// savefile.h
+#ifndef SAVEFILE_H
+#define SAVEFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "position.h"
+
+const std::string SAVE_SLOTS_FILENAME = "multiplication" VARIANT_TAG "_saves.bin";
+const int SAVE_SLOT_COUNT = 16;
+const int SAVE_NAME_LENGTH = 31;
+const int PACKED_BOARD_BYTES = (NUM_CELLS * 2 + 7) / 8;
+
+struct SaveSlot {
+    bool used = false;
+    std::string name;
+    Position pos;
+    int64_t savedAt = 0;     // seconds since the epoch
+};
+
+// Versioned binary save file: a fixed header, then SAVE_SLOT_COUNT fixed-size
+// records, each with its own checksum over a 2-bit-per-cell board, the active
+// factor and the side to move. Every slot sits at a known offset, so listing
+// or loading one is a single small read. Writes replace the whole file via a
+// temporary file and rename, so a crash leaves the old or the new file. A
+// file that exists but cannot be read is moved to path + ".bad" before the
+// first write, never overwritten.
+// A slot with a bad checksum reads as unused instead of failing the file.
+bool readSaveSlots(const std::string &path, std::vector<SaveSlot> &slots);
+bool readSaveSlot(const std::string &path, int index, SaveSlot &slot);
+bool writeSaveSlot(const std::string &path, int index, const std::string &name,
+                   const Position &pos, int64_t savedAt);
+
+// Result of parsing one position of a multiplication_save.txt style text:
+// the active factor and a turn flag (1 for the human) on one line, then one
+// line of BOARD_SIZE owners (0, 1 or 2) per row
+enum TextParseResult { TEXT_END, TEXT_VALID, TEXT_INVALID };
+
+// Parses the next position in [cursor, end) in place and moves cursor past
+// it, skipping blank lines before it. Any number of positions can follow one
+// another; a malformed one still consumes its 1 + BOARD_SIZE lines, so the
+// next one parses normally. No copies, allocations or streams, so a mapped
+// file of millions of positions is parsed at memory speed.
+TextParseResult parseTextPosition(const char *&cursor, const char *end, Position &pos);
+
+// Finishes a file written to tempPath and renames it over path: the data is
+// fsynced before the rename and the directory after it, so after a crash path
+// holds the old contents or the new, never a torn or empty file. `written`
+// says whether writing `out` succeeded; on any failure tempPath is removed.
+// Shared with the opening book and the solved database.
+bool replaceFile(FILE *out, bool written, const std::string &tempPath, const std::string &path);
+
+// Owner of each cell in 2 bits, cell 0 in the low bits; shared with the journal
+void packBoard(const Position &pos, uint8_t out[PACKED_BOARD_BYTES]);
+bool unpackBoard(const uint8_t in[PACKED_BOARD_BYTES], int activeFactor, int sideToMove, Position &pos);
+
+#endif
@@ -0,0 +1,291 @@
+#include "search.h"
+#include "movestack.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Win scores are stored relative to the node so they stay valid at any ply
+int scoreToTable(int score, int ply){
+    if(score >= WIN_SCORE - 2 * MAX_SEARCH_DEPTH) return score + ply;
+    if(score <= -(WIN_SCORE - 2 * MAX_SEARCH_DEPTH)) return score - ply;
+    return score;
+}
+
+int scoreFromTable(int score, int ply){
+    if(score >= WIN_SCORE - 2 * MAX_SEARCH_DEPTH) return score - ply;
+    if(score <= -(WIN_SCORE - 2 * MAX_SEARCH_DEPTH)) return score + ply;
+    return score;
+}
+
+struct Searcher {
+    Clock::time_point start;
+    Clock::time_point deadline;
+    TranspositionTable *table = nullptr;
+    std::atomic<bool> *sharedStop = nullptr;  // raised by the main thread for all workers
+    std::atomic<bool> *cancel = nullptr;      // the caller's SearchLimits::cancel
+    bool isMain = true;
+    uint64_t nodes = 0;
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    bool canStop = false;  // never abandon the first iteration
+    bool stopped = false;
+    MoveStack line;        // current path from the root; every node is made and unmade here
+
+    void checkTime(){
+        if(isMain && cancel && cancel->load(std::memory_order_relaxed)){
+            stopped = true;
+            sharedStop->store(true, std::memory_order_relaxed);
+        }else if(canStop && sharedStop->load(std::memory_order_relaxed)){
+            stopped = true;
+        }else if(isMain && canStop && (nodes & 1023) == 0 && Clock::now() >= deadline){
+            stopped = true;
+            sharedStop->store(true, std::memory_order_relaxed);
+        }
+    }
+
+    int negamax(int depth, int alpha, int beta, int ply, bool afterPass){
+        const Position &pos = line.position();
+        nodes++;
+        checkTime();
+        if(stopped) return 0;
+
+        Bitboard legal = legalMoves(pos);
+        if(!legal){
+            // Same rule as playGame(): pass, and a draw if the opponent is stuck as well
+            if(afterPass) return 0;
+            line.pass();
+            int score = -negamax(depth, -beta, -alpha, ply + 1, true);
+            line.unmake();
+            return score;
+        }
+        if(isDead(pos)) return 0;
+
+        const int side = pos.sideToMove;
+        for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+            int cell = MOVE_CELL[pos.activeFactor][f];
+            if((legal & (Bitboard(1) << cell)) && hasWinLineThrough(pos.bits[side] | (Bitboard(1) << cell), cell)){
+                return WIN_SCORE - (ply + 1);
+            }
+        }
+        if(depth <= 0) return line.evaluate();
+
+        const uint64_t key = pos.key;
+        int ttFactor = 0;
+        if(table){
+            TTHit hit;
+            ttProbes++;
+            if(table->probe(key, hit)){
+                ttHits++;
+                ttFactor = hit.factor;
+                if(hit.depth >= depth){
+                    int score = scoreFromTable(hit.score, ply);
+                    if(hit.bound == BOUND_EXACT) return score;
+                    if(hit.bound == BOUND_LOWER && score >= beta) return score;
+                    if(hit.bound == BOUND_UPPER && score <= alpha) return score;
+                }
+            }
+        }
+
+        // Table move first, then the remaining factors in ascending order
+        int order[MAX_FACTOR];
+        int count = 0;
+        const int activeFactor = pos.activeFactor;
+        if(ttFactor && (legal & (Bitboard(1) << MOVE_CELL[activeFactor][ttFactor]))) order[count++] = ttFactor;
+        for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+            if(f != ttFactor && (legal & (Bitboard(1) << MOVE_CELL[activeFactor][f]))) order[count++] = f;
+        }
+
+        const int alphaOrig = alpha;
+        int best = -INFINITE_SCORE;
+        int bestFactor = 0;
+        for(int i = 0; i < count; i++){
+            int f = order[i];
+            line.make(f);
+            int score = -negamax(depth - 1, -beta, -alpha, ply + 1, false);
+            line.unmake();
+            if(stopped) return 0;
+            if(score > best){
+                best = score;
+                bestFactor = f;
+                if(score > alpha) alpha = score;
+                if(alpha >= beta) break;
+            }
+        }
+        if(table){
+            Bound bound = best <= alphaOrig ? BOUND_UPPER : best >= beta ? BOUND_LOWER : BOUND_EXACT;
+            table->store(key, scoreToTable(best, ply), depth, bound, bestFactor);
+        }
+        return best;
+    }
+};
+
+int elapsedSince(Clock::time_point start){
+    return (int)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+} // namespace
+
+// Sums open-line weights for the side to move minus those of the opponent;
+// the search reads the same score incrementally from its MoveStack
+int evaluatePosition(const Position &pos){
+    const Bitboard human = pos.bits[HUMAN_PLAYER];
+    const Bitboard computer = pos.bits[COMPUTER_PLAYER];
+    int score = 0;
+    for(Bitboard line : WIN_LINES) score += LINE_STATE_SCORES[lineState(human, computer, line)];
+    return pos.sideToMove == HUMAN_PLAYER ? score : -score;
+}
+
+bool isWinScore(int score){
+    return score >= WIN_SCORE - 2 * MAX_SEARCH_DEPTH || score <= -(WIN_SCORE - 2 * MAX_SEARCH_DEPTH);
+}
+
+namespace {
+
+// One worker's iterative deepening loop; helpers start one ply deeper on odd
+// ids and rotate the root order so they fill the table with different lines
+void iterativeDeepening(Searcher &searcher, const Position &root, const SearchLimits &limits,
+                        int threadId, SearchResult &result){
+    searcher.line.reset(root);
+    const Position &pos = searcher.line.position();
+    Bitboard legal = legalMoves(pos);
+
+    struct RootMove { int factor; int score; Bound bound; };
+    RootMove moves[MAX_FACTOR];
+    int moveCount = 0;
+    for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+        if(legal & (Bitboard(1) << MOVE_CELL[pos.activeFactor][f])) moves[moveCount++] = {f, 0, BOUND_NONE};
+    }
+    TTHit hit;
+    if(limits.table && limits.table->probe(pos.key, hit)){
+        for(int i = 1; i < moveCount; i++){
+            if(moves[i].factor == hit.factor) std::swap(moves[0], moves[i]);
+        }
+    }
+    if(threadId > 0) std::rotate(moves, moves + threadId % moveCount, moves + moveCount);
+    result.factor = moves[0].factor;
+
+    const int emptyCells = NUM_CELLS - popCount(occupied(pos));
+    const int maxDepth = std::min(limits.maxDepth, emptyCells);
+    for(int depth = 1 + (threadId & 1); depth <= maxDepth; depth++){
+        int alpha = -INFINITE_SCORE;
+        for(int i = 0; i < moveCount; i++){
+            int cell = searcher.line.make(moves[i].factor);
+            const bool won = wonAt(pos, cell, root.sideToMove);
+            int score = won ? WIN_SCORE - 1 : -searcher.negamax(depth - 1, -INFINITE_SCORE, -alpha, 1, false);
+            searcher.line.unmake();
+            if(searcher.stopped) break;
+            moves[i].score = score;
+            // A score at or below alpha failed low: the move is at most that good
+            moves[i].bound = won || score > alpha ? BOUND_EXACT : BOUND_UPPER;
+            if(score > alpha) alpha = score;
+        }
+        if(searcher.stopped) break;
+
+        // Best move of this iteration is searched first in the next one
+        std::stable_sort(moves, moves + moveCount,
+                         [](const RootMove &a, const RootMove &b){ return a.score > b.score; });
+        result.factor = moves[0].factor;
+        result.score = moves[0].score;
+        result.depth = depth;
+        result.factorScores.assign(MAX_FACTOR + 1, -INFINITE_SCORE);
+        result.factorBounds.assign(MAX_FACTOR + 1, BOUND_NONE);
+        for(int i = 0; i < moveCount; i++){
+            result.factorScores[moves[i].factor] = moves[i].score;
+            result.factorBounds[moves[i].factor] = moves[i].bound;
+        }
+        searcher.canStop = true;
+        if(limits.table) limits.table->store(root.key, result.score, depth, BOUND_EXACT, result.factor);
+        if(isWinScore(result.score)) break;
+        if(searcher.isMain && elapsedSince(searcher.start) >= limits.timeMs) break;
+        if(searcher.sharedStop->load(std::memory_order_relaxed)) break;
+    }
+    result.nodes = searcher.nodes;
+    result.ttProbes = searcher.ttProbes;
+    result.ttHits = searcher.ttHits;
+}
+
+} // namespace
+
+// Lazy SMP: every worker searches the whole tree and they share results
+// through the transposition table; the main thread owns the clock
+SearchResult searchBestFactor(const Position &root, const SearchLimits &limits){
+    SearchResult result;
+    if(!legalMoves(root)) return result;
+
+    const Clock::time_point start = Clock::now();
+    const int threadCount = std::max(1, std::min(limits.threads, MAX_SEARCH_THREADS));
+    if(limits.table) limits.table->newSearch();
+
+    std::atomic<bool> stop(false);
+    std::vector<Searcher> searchers(threadCount);
+    std::vector<SearchResult> results(threadCount);
+    for(int i = 0; i < threadCount; i++){
+        searchers[i].start = start;
+        searchers[i].deadline = start + std::chrono::milliseconds(limits.timeMs);
+        searchers[i].table = limits.table;
+        searchers[i].sharedStop = &stop;
+        searchers[i].cancel = limits.cancel;
+        searchers[i].isMain = (i == 0);
+        searchers[i].canStop = (i != 0);
+    }
+
+    std::vector<std::thread> helpers;
+    for(int i = 1; i < threadCount; i++){
+        helpers.emplace_back([&, i](){ iterativeDeepening(searchers[i], root, limits, i, results[i]); });
+    }
+    iterativeDeepening(searchers[0], root, limits, 0, results[0]);
+    stop.store(true, std::memory_order_relaxed);
+    for(auto &helper : helpers) helper.join();
+
+    // Take the deepest completed iteration, the main thread wins ties
+    int bestThread = 0;
+    for(int i = 1; i < threadCount; i++){
+        if(results[i].depth > results[bestThread].depth) bestThread = i;
+    }
+    result = results[bestThread];
+    result.nodes = result.ttProbes = result.ttHits = 0;
+    for(const SearchResult &r : results){
+        result.nodes += r.nodes;
+        result.ttProbes += r.ttProbes;
+        result.ttHits += r.ttHits;
+        result.threadNodes.push_back(r.nodes);
+    }
+    if(limits.table) limits.table->recordProbes(result.ttProbes, result.ttHits);
+    result.elapsedMs = elapsedSince(start);
+    return result;
+}
+
+std::vector<int> principalVariation(const Position &root, const TranspositionTable &table,
+                                    int firstFactor, int maxPlies){
+    std::vector<int> line;
+    Position pos = root;
+    int factor = firstFactor;
+    while((int)line.size() < maxPlies && isLegalFactor(pos, factor)){
+        const int side = pos.sideToMove;
+        const int cell = makeMove(pos, factor);
+        line.push_back(factor);
+        if(wonAt(pos, cell, side) || isDead(pos)) break;
+        if(!legalMoves(pos)){
+            makePass(pos);
+            if(!legalMoves(pos)) break;
+            line.push_back(0);
+        }
+        // The search returns on a winning move without storing it
+        factor = 0;
+        const Bitboard legal = legalMoves(pos);
+        for(int f = MIN_FACTOR; f <= MAX_FACTOR && !factor; f++){
+            int target = MOVE_CELL[pos.activeFactor][f];
+            if((legal & (Bitboard(1) << target)) && hasWinLineThrough(pos.bits[pos.sideToMove] | (Bitboard(1) << target), target)){
+                factor = f;
+            }
+        }
+        TTHit hit;
+        if(!factor && table.probe(pos.key, hit)) factor = hit.factor;
+    }
+    return line;
+}
@@ -0,0 +1,53 @@
+// search.h
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "position.h"
+#include "tt.h"
+
+const int DEFAULT_THINK_MS = 1000;
+const int MAX_SEARCH_DEPTH = NUM_CELLS;
+const int WIN_SCORE = 1000000;
+const int INFINITE_SCORE = WIN_SCORE + 1;
+const int MAX_SEARCH_THREADS = 256;
+
+struct SearchLimits {
+    int timeMs = DEFAULT_THINK_MS;    // wall-clock budget for the whole move
+    int maxDepth = MAX_SEARCH_DEPTH;  // plies, passes are not counted
+    TranspositionTable *table = nullptr;  // optional, may be shared between searches
+    int threads = 1;                  // Lazy SMP workers sharing `table`
+    std::atomic<bool> *cancel = nullptr;  // optional, raised by the caller to abandon the search
+};
+
+struct SearchResult {
+    int factor = -1;      // best factor, -1 when the side to move has to pass
+    int score = 0;        // from the side to move's point of view
+    int depth = 0;        // last fully searched depth
+    uint64_t nodes = 0;
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+    int elapsedMs = 0;
+    std::vector<uint64_t> threadNodes;  // nodes searched by each worker
+    // Root scores of the last completed iteration by factor, -INFINITE_SCORE
+    // for factors not played. Moves that failed low against the best so far
+    // only have an upper bound, marked BOUND_UPPER in factorBounds; the best
+    // move and any that raised alpha are BOUND_EXACT.
+    std::vector<int> factorScores;
+    std::vector<Bound> factorBounds;
+};
+
+// Scores are from the side to move's point of view
+int evaluatePosition(const Position &pos);
+bool isWinScore(int score);
+SearchResult searchBestFactor(const Position &pos, const SearchLimits &limits);
+
+// The line the search expects after it chose `firstFactor`, read back from
+// the table it filled: at most maxPlies moves, 0 standing for a pass. Ends
+// early where an entry has been overwritten.
+std::vector<int> principalVariation(const Position &pos, const TranspositionTable &table,
+                                    int firstFactor, int maxPlies);
+
+#endif
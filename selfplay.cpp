@@ -0,0 +1,193 @@
+// Headless self-play: plays engine-vs-engine games on all cores and reports
+// throughput and results. No terminal or ncurses dependency.
+#include "gamecore.h"
+#include "search.h"
+#include "mcts.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+enum PlayerKind { PLAYER_RANDOM, PLAYER_GREEDY, PLAYER_ALPHABETA, PLAYER_MCTS };
+const char *PLAYER_NAMES[] = {"random", "greedy", "alphabeta", "mcts"};
+
+struct SelfPlayOptions {
+    PlayerKind first = PLAYER_GREEDY;      // engine A
+    PlayerKind second = PLAYER_RANDOM;     // engine B
+    uint64_t games = 10000;
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    int depth = 4;                         // alphabeta plies
+    int thinkMs = 1000;                    // alphabeta and mcts budget per move
+    uint64_t playouts = 2000;              // mcts playouts per move
+    int mctsNodes = 1 << 18;
+    int hashMb = 4;                        // alphabeta table per worker
+    uint64_t seed = 1;
+};
+
+// Totals from A's point of view; A plays the first mover in even games
+struct SelfPlayStats {
+    uint64_t games = 0;
+    uint64_t winsA = 0;
+    uint64_t winsB = 0;
+    uint64_t draws = 0;
+    uint64_t deadDraws = 0;   // drawn because neither side could still make a line
+    uint64_t moves = 0;
+    uint64_t passes = 0;
+
+    void add(const SelfPlayStats &other){
+        games += other.games;
+        winsA += other.winsA;
+        winsB += other.winsB;
+        draws += other.draws;
+        deadDraws += other.deadDraws;
+        moves += other.moves;
+        passes += other.passes;
+    }
+};
+
+// Everything a worker needs to play its share of games without sharing state
+struct Worker {
+    const SelfPlayOptions &options;
+    TranspositionTable table;
+    std::unique_ptr<MctsEngine> mcts;
+    uint64_t rng = 0;
+    SelfPlayStats stats;
+
+    explicit Worker(const SelfPlayOptions &opts) : options(opts), table(opts.hashMb) {
+        if(opts.first == PLAYER_MCTS || opts.second == PLAYER_MCTS){
+            mcts.reset(new MctsEngine(opts.mctsNodes));
+        }
+    }
+
+    int chooseFactor(PlayerKind kind, const Position &pos);
+    void playGame(uint64_t index);
+};
+
+int Worker::chooseFactor(PlayerKind kind, const Position &pos){
+    switch(kind){
+        case PLAYER_RANDOM:
+            return randomFactor(pos, rng);
+        case PLAYER_GREEDY:
+            return greedyFactor(pos);
+        case PLAYER_ALPHABETA: {
+            SearchLimits limits;
+            limits.timeMs = options.thinkMs;
+            limits.maxDepth = options.depth;
+            limits.table = &table;
+            return searchBestFactor(pos, limits).factor;
+        }
+        case PLAYER_MCTS: {
+            MctsLimits limits;
+            limits.timeMs = options.thinkMs;
+            limits.maxPlayouts = options.playouts;
+            limits.seed = splitmix64(rng);
+            return mcts->search(pos, limits).factor;
+        }
+    }
+    return -1;
+}
+
+// Same opening as the game: random starting factor and random first mover
+void Worker::playGame(uint64_t index){
+    rng = options.seed ^ (index * 0x9E3779B97F4A7C15ULL);
+    const int firstFactor = MIN_FACTOR + (int)(splitmix64(rng) % MAX_FACTOR);
+    const int firstSide = splitmix64(rng) % 2 ? HUMAN_PLAYER : COMPUTER_PLAYER;
+    const int sideA = index % 2 == 0 ? firstSide : opponentOf(firstSide);
+    Game game(firstFactor, firstSide);
+    if(mcts) mcts->reset();
+
+    while(!game.isOver()){
+        const Position &pos = game.position();
+        int factor = chooseFactor(pos.sideToMove == sideA ? options.first : options.second, pos);
+        if(!game.play(factor)) game.play(randomFactor(pos, rng));
+    }
+    stats.games++;
+    stats.moves += game.moves();
+    stats.passes += game.passes();
+    if(game.endedDead()) stats.deadDraws++;
+    if(game.result() == DRAW_RESULT) stats.draws++;
+    else if(game.result() == sideA) stats.winsA++;
+    else stats.winsB++;
+}
+
+bool parsePlayer(const std::string &name, PlayerKind &kind){
+    for(int i = 0; i < 4; i++){
+        if(name == PLAYER_NAMES[i]){
+            kind = (PlayerKind)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseOptions(int argc, char **argv, SelfPlayOptions &options){
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(i + 1 >= argc) return false;
+        const char *value = argv[++i];
+        if(arg == "--a"){ if(!parsePlayer(value, options.first)) return false; }
+        else if(arg == "--b"){ if(!parsePlayer(value, options.second)) return false; }
+        else if(arg == "--games") options.games = std::strtoull(value, nullptr, 10);
+        else if(arg == "--threads") options.threads = std::atoi(value);
+        else if(arg == "--depth") options.depth = std::atoi(value);
+        else if(arg == "--think-ms") options.thinkMs = std::atoi(value);
+        else if(arg == "--playouts") options.playouts = std::strtoull(value, nullptr, 10);
+        else if(arg == "--mcts-nodes") options.mctsNodes = std::atoi(value);
+        else if(arg == "--hash") options.hashMb = std::atoi(value);
+        else if(arg == "--seed") options.seed = std::strtoull(value, nullptr, 10);
+        else return false;
+    }
+    return options.games > 0 && options.threads > 0 && options.depth > 0 && options.thinkMs > 0
+        && options.mctsNodes >= 1024 && options.hashMb > 0;
+}
+
+double percent(uint64_t part, uint64_t whole){
+    return whole ? 100.0 * part / whole : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char **argv){
+    SelfPlayOptions options;
+    if(!parseOptions(argc, argv, options)){
+        std::fprintf(stderr, "Usage: %s [--a engine] [--b engine] [--games n] [--threads n] [--depth n]\n"
+                             "          [--think-ms ms] [--playouts n] [--mcts-nodes n] [--hash MB] [--seed n]\n"
+                             "Engines: random, greedy, alphabeta, mcts\n", argv[0]);
+        return 1;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    std::atomic<uint64_t> nextGame(0);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for(int t = 0; t < options.threads; t++) workers.emplace_back(new Worker(options));
+    std::vector<std::thread> threads;
+    for(auto &worker : workers){
+        Worker *w = worker.get();
+        threads.emplace_back([w, &nextGame, &options](){
+            for(uint64_t i = nextGame++; i < options.games; i = nextGame++) w->playGame(i);
+        });
+    }
+    for(auto &thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    SelfPlayStats total;
+    for(auto &worker : workers) total.add(worker->stats);
+    std::printf("Played %llu games in %.2f s on %d threads: %.0f games/sec\n",
+                (unsigned long long)total.games, seconds, options.threads,
+                seconds > 0 ? total.games / seconds : 0.0);
+    std::printf("%s vs %s: %.1f%% wins, %.1f%% draws, %.1f%% losses (%.1f%% of games dead draws)\n",
+                PLAYER_NAMES[options.first], PLAYER_NAMES[options.second],
+                percent(total.winsA, total.games), percent(total.draws, total.games),
+                percent(total.winsB, total.games), percent(total.deadDraws, total.games));
+    std::printf("Average length %.1f moves, %.3f passes per game (%.2f%% of turns)\n",
+                total.games ? (double)total.moves / total.games : 0.0,
+                total.games ? (double)total.passes / total.games : 0.0,
+                percent(total.passes, total.moves + total.passes));
+    return 0;
+}
@@ -0,0 +1,833 @@
+// Engine server: any number of independent games driven over a line-based
+// text protocol on stdin/stdout and, with --socket, a Unix domain socket.
+// One thread runs an epoll loop that parses requests and owns every game; a
+// pool of workers runs the searches and hands results back through an
+// eventfd, so a slow search never holds up another client.
+#include "gamecore.h"
+#include "search.h"
+#include "tt.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t MAX_LINE_LENGTH = 4096;
+const size_t MAX_PENDING_OUTPUT = 1 << 20;   // stop reading a client that does not read its replies
+const size_t READ_CHUNK = 65536;
+const int MAX_EVENTS = 256;
+
+// epoll tags below FIRST_CONNECTION_ID, connection ids from it upwards
+const uint64_t LISTEN_TAG = 1;
+const uint64_t NOTIFY_TAG = 2;
+const uint64_t SIGNAL_TAG = 3;
+const uint64_t STDOUT_TAG = 4;
+const uint64_t FIRST_CONNECTION_ID = 16;
+
+const char *COMMANDS[] = {"new", "position", "move", "go", "stop", "show", "free", "stats", "ping", "quit"};
+
+struct ServerOptions {
+    std::string socketPath;                // empty: stdin/stdout only
+    bool stdio = true;
+    int workers = (int)std::max(1u, std::thread::hardware_concurrency());
+    int hashMb = DEFAULT_HASH_MB;          // transposition table per worker
+    int thinkMs = DEFAULT_THINK_MS;        // for go without a time limit
+    size_t maxGames = 1 << 20;
+    uint64_t seed = 1;                     // opening factors of new without one
+};
+
+uint64_t microsSince(Clock::time_point start){
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+// Latencies of one kind of request in power-of-two microsecond buckets, so
+// percentiles cost a fixed set of counters however many requests are served
+struct LatencyStats {
+    static const int BUCKETS = 40;
+    uint64_t count = 0;
+    uint64_t totalUs = 0;
+    uint64_t maxUs = 0;
+    uint64_t buckets[BUCKETS] = {};
+
+    void add(uint64_t us){
+        count++;
+        totalUs += us;
+        maxUs = std::max(maxUs, us);
+        int bucket = 0;
+        while(bucket < BUCKETS - 1 && (uint64_t(1) << bucket) <= us) bucket++;
+        buckets[bucket]++;
+    }
+
+    // Upper end of the bucket holding the request at `share` of the way up
+    uint64_t percentile(double share) const {
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)(share * count + 0.999999));
+        uint64_t seen = 0;
+        for(int b = 0; b < BUCKETS; b++){
+            seen += buckets[b];
+            if(seen >= rank) return std::min(maxUs, (uint64_t(1) << b) - 1);
+        }
+        return maxUs;
+    }
+};
+
+struct SearchJob {
+    uint64_t gameId = 0;
+    Position pos;
+    int timeMs = DEFAULT_THINK_MS;
+    int maxDepth = MAX_SEARCH_DEPTH;
+    std::atomic<bool> cancel{false};
+    Clock::time_point received;          // when the go request was read
+    SearchResult result;
+};
+
+// Each worker runs one single-threaded search at a time with its own table:
+// throughput comes from many games at once rather than from Lazy SMP
+class WorkerPool {
+public:
+    WorkerPool(int workers, int hashMb, int notifyFd);
+    ~WorkerPool();
+
+    void submit(const std::shared_ptr<SearchJob> &job);
+    void takeFinished(std::vector<std::shared_ptr<SearchJob>> &out);
+    size_t queued();
+    size_t running() const { return active.load(std::memory_order_relaxed); }
+
+private:
+    void run(int hashMb);
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::shared_ptr<SearchJob>> pending;
+    std::vector<std::shared_ptr<SearchJob>> finished;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> active{0};
+    int notifyFd;
+    bool stopping = false;
+};
+
+WorkerPool::WorkerPool(int workers, int hashMb, int fd) : notifyFd(fd) {
+    for(int i = 0; i < workers; i++) threads.emplace_back([this, hashMb](){ run(hashMb); });
+}
+
+// Queued searches are dropped; the caller cancels the running ones first
+WorkerPool::~WorkerPool(){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(auto &thread : threads) thread.join();
+}
+
+void WorkerPool::submit(const std::shared_ptr<SearchJob> &job){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(job);
+    }
+    wake.notify_one();
+}
+
+void WorkerPool::takeFinished(std::vector<std::shared_ptr<SearchJob>> &out){
+    std::lock_guard<std::mutex> lock(mutex);
+    out.swap(finished);
+}
+
+size_t WorkerPool::queued(){
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending.size();
+}
+
+void WorkerPool::run(int hashMb){
+    TranspositionTable table(hashMb);
+    for(;;){
+        std::shared_ptr<SearchJob> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this](){ return stopping || !pending.empty(); });
+            if(stopping) return;
+            job = std::move(pending.front());
+            pending.pop_front();
+            active++;
+        }
+        SearchLimits limits;
+        limits.timeMs = job->timeMs;
+        limits.maxDepth = job->maxDepth;
+        limits.table = &table;
+        limits.cancel = &job->cancel;
+        job->result = searchBestFactor(job->pos, limits);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(std::move(job));
+            active--;
+        }
+        uint64_t one = 1;
+        ssize_t written = write(notifyFd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+struct Connection {
+    int inFd = -1;
+    int outFd = -1;
+    bool isSocket = false;
+    std::string input;                   // bytes read but not yet a whole line
+    std::string output;                  // replies not yet written
+    uint32_t events = 0;                 // what epoll watches: EPOLLIN on the input, EPOLLOUT on the output
+    bool outputPolled = false;           // stdout only: non-blocking and watched by epoll
+    bool inputClosed = false;            // end of input: close once its searches have reported
+    bool quit = false;                   // close once the output is written
+    bool broken = false;                 // a write failed: close at once
+    std::unordered_set<uint64_t> games;
+    int searching = 0;                   // of its games, how many have a search queued or running
+};
+
+struct ServerGame {
+    Game game;
+    uint64_t connection;                 // the owner, the only client that can use it
+    std::shared_ptr<SearchJob> search;   // queued or running, at most one
+    bool freed = false;                  // dropped by its owner while it was searching
+};
+
+bool parseNumber(const std::string &word, long long &value){
+    if(word.empty()) return false;
+    char *end = nullptr;
+    errno = 0;
+    value = std::strtoll(word.c_str(), &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+bool parseSide(const std::string &word, int &side){
+    if(word == "human") side = HUMAN_PLAYER;
+    else if(word == "computer") side = COMPUTER_PLAYER;
+    else return false;
+    return true;
+}
+
+const char *sideName(int side){
+    return side == HUMAN_PLAYER ? "human" : "computer";
+}
+
+std::vector<std::string> splitWords(const std::string &line){
+    std::vector<std::string> words;
+    size_t i = 0;
+    while(i < line.size()){
+        while(i < line.size() && std::isspace((unsigned char)line[i])) i++;
+        size_t start = i;
+        while(i < line.size() && !std::isspace((unsigned char)line[i])) i++;
+        if(i > start) words.push_back(line.substr(start, i - start));
+    }
+    return words;
+}
+
+// "turn human factor 6", "won computer" or "draw"
+std::string gameStatus(const Game &game){
+    if(!game.isOver()) return std::string("turn ") + sideName(game.sideToMove()) + " factor " + std::to_string(game.activeFactor());
+    if(game.result() == DRAW_RESULT) return "draw";
+    return std::string("won ") + sideName(game.result());
+}
+
+// One character per cell, row by row: '.' empty, 'h' human, 'c' computer
+std::string boardString(const Position &pos){
+    std::string cells(NUM_CELLS, '.');
+    for(int cell = 0; cell < NUM_CELLS; cell++){
+        if(pos.bits[HUMAN_PLAYER] & (Bitboard(1) << cell)) cells[cell] = 'h';
+        else if(pos.bits[COMPUTER_PLAYER] & (Bitboard(1) << cell)) cells[cell] = 'c';
+    }
+    return cells;
+}
+
+bool parseBoard(const std::string &cells, int factor, int side, Position &pos){
+    if(cells.size() != (size_t)NUM_CELLS || !isFactor(factor)) return false;
+    clearPosition(pos, factor, side);
+    for(int cell = 0; cell < NUM_CELLS; cell++){
+        char c = cells[cell];
+        if(c == '.') continue;
+        if((c != 'h' && c != 'c') || !isPlayableCell(cell / BOARD_SIZE, cell % BOARD_SIZE)) return false;
+        setMark(pos, cell, c == 'h' ? HUMAN_PLAYER : COMPUTER_PLAYER);
+    }
+    return true;
+}
+
+class Server {
+public:
+    explicit Server(const ServerOptions &opts) : options(opts), rng(opts.seed) {}
+    ~Server();
+    bool setUp(int signalFd);
+    void run();
+
+private:
+    uint64_t addConnection(int inFd, int outFd, bool isSocket);
+    void acceptClients();
+    void readInput(uint64_t id);
+    void handleRequest(uint64_t id, const std::string &line, Clock::time_point received);
+    std::string newGame(uint64_t id, const std::vector<std::string> &words);
+    std::string setPosition(uint64_t id, const std::vector<std::string> &words);
+    std::string playMove(uint64_t id, const std::vector<std::string> &words);
+    std::string startSearch(uint64_t id, const std::vector<std::string> &words, Clock::time_point received);
+    std::string stopSearch(uint64_t id, const std::vector<std::string> &words);
+    std::string showGame(uint64_t id, const std::vector<std::string> &words);
+    std::string freeGame(uint64_t id, const std::vector<std::string> &words);
+    std::string statsLine();
+    ServerGame *findGame(uint64_t id, const std::vector<std::string> &words, std::string &error);
+    void finishSearches();
+    void send(uint64_t id, const std::string &line);
+    void flush(uint64_t id);
+    void watch(uint64_t id);
+    void closeConnection(uint64_t id);
+
+    ServerOptions options;
+    uint64_t rng;
+    int epollFd = -1;
+    int listenFd = -1;
+    int notifyFd = -1;
+    bool stdinPolled = true;             // false when stdin is a file epoll cannot watch
+    int stdoutFlags = -1;                // restored on exit once stdout was made non-blocking
+    uint64_t stdioId = 0;
+    bool running = true;
+    std::unique_ptr<WorkerPool> pool;
+    std::unordered_map<uint64_t, Connection> connections;
+    std::unordered_map<uint64_t, ServerGame> games;
+    std::unordered_set<uint64_t> dirty;  // connections with output to write or a close to check
+    uint64_t nextConnectionId = FIRST_CONNECTION_ID;
+    uint64_t nextGameId = 1;
+
+    Clock::time_point started = Clock::now();
+    uint64_t requests = 0;
+    uint64_t searches = 0;
+    uint64_t nodes = 0;
+    std::map<std::string, LatencyStats> latency;
+};
+
+Server::~Server(){
+    for(auto &entry : games){
+        if(entry.second.search) entry.second.search->cancel = true;
+    }
+    pool.reset();
+    for(auto &entry : connections){
+        if(entry.second.isSocket) ::close(entry.second.inFd);
+    }
+    if(listenFd >= 0){
+        ::close(listenFd);
+        unlink(options.socketPath.c_str());
+    }
+    if(notifyFd >= 0) ::close(notifyFd);
+    if(epollFd >= 0) ::close(epollFd);
+    // The flag belongs to the open file, which a terminal shares with the shell
+    if(stdoutFlags >= 0) fcntl(STDOUT_FILENO, F_SETFL, stdoutFlags);
+}
+
+bool Server::setUp(int signalFd){
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    notifyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(epollFd < 0 || notifyFd < 0) return false;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = NOTIFY_TAG;
+    if(epoll_ctl(epollFd, EPOLL_CTL_ADD, notifyFd, &ev) != 0) return false;
+    ev.data.u64 = SIGNAL_TAG;
+    if(epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &ev) != 0) return false;
+
+    if(!options.socketPath.empty()){
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if(options.socketPath.size() >= sizeof(address.sun_path)) return false;
+        std::memcpy(address.sun_path, options.socketPath.c_str(), options.socketPath.size());
+        unlink(options.socketPath.c_str());
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(listenFd < 0 || bind(listenFd, (sockaddr *)&address, sizeof(address)) != 0
+           || listen(listenFd, SOMAXCONN) != 0) return false;
+        ev.data.u64 = LISTEN_TAG;
+        if(epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev) != 0) return false;
+    }
+
+    if(options.stdio){
+        stdioId = addConnection(STDIN_FILENO, STDOUT_FILENO, false);
+        Connection &conn = connections[stdioId];
+        ev.data.u64 = stdioId;
+        if(epoll_ctl(epollFd, EPOLL_CTL_ADD, STDIN_FILENO, &ev) == 0) conn.events = EPOLLIN;
+        else if(errno == EPERM) stdinPolled = false;
+        else return false;
+        // A pipe, socket or terminal on stdout gets the sockets' back-pressure, so
+        // a peer that stops reading holds up only itself; a file is written through
+        ev.events = 0;
+        ev.data.u64 = STDOUT_TAG;
+        if(epoll_ctl(epollFd, EPOLL_CTL_ADD, STDOUT_FILENO, &ev) == 0){
+            stdoutFlags = fcntl(STDOUT_FILENO, F_GETFL);
+            if(stdoutFlags < 0 || fcntl(STDOUT_FILENO, F_SETFL, stdoutFlags | O_NONBLOCK) != 0) return false;
+            conn.outputPolled = true;
+        }else if(errno != EPERM){
+            return false;
+        }
+    }
+
+    pool.reset(new WorkerPool(options.workers, options.hashMb, notifyFd));
+    return true;
+}
+
+uint64_t Server::addConnection(int inFd, int outFd, bool isSocket){
+    uint64_t id = nextConnectionId++;
+    Connection &conn = connections[id];
+    conn.inFd = inFd;
+    conn.outFd = outFd;
+    conn.isSocket = isSocket;
+    return id;
+}
+
+void Server::run(){
+    epoll_event events[MAX_EVENTS];
+    while(running){
+        // A regular file on stdin is always readable but cannot be registered
+        bool stdinReady = !stdinPolled && connections.count(stdioId) && !connections[stdioId].inputClosed
+                       && connections[stdioId].output.size() < MAX_PENDING_OUTPUT;
+        int count = epoll_wait(epollFd, events, MAX_EVENTS, stdinReady ? 0 : -1);
+        if(count < 0 && errno != EINTR) break;
+        if(stdinReady) readInput(stdioId);
+        for(int i = 0; i < count && running; i++){
+            const uint64_t tag = events[i].data.u64;
+            if(tag == LISTEN_TAG) acceptClients();
+            else if(tag == NOTIFY_TAG) finishSearches();
+            else if(tag == SIGNAL_TAG) running = false;
+            else if(tag == STDOUT_TAG){
+                if(!connections.count(stdioId)) continue;
+                if(events[i].events & (EPOLLERR | EPOLLHUP)) connections[stdioId].broken = true;
+                dirty.insert(stdioId);
+            }
+            else if(connections.count(tag)){
+                Connection &conn = connections[tag];
+                const uint32_t got = events[i].events;
+                // A pipe reports a hang-up while data written before it is still unread
+                if(!conn.isSocket || (got & EPOLLIN)) readInput(tag);
+                if(conn.isSocket && (got & (EPOLLERR | EPOLLHUP))) conn.broken = true;
+                dirty.insert(tag);
+            }
+        }
+
+        std::vector<uint64_t> touched(dirty.begin(), dirty.end());
+        dirty.clear();
+        for(uint64_t id : touched){
+            auto it = connections.find(id);
+            if(it == connections.end()) continue;
+            flush(id);
+            Connection &conn = it->second;
+            if(conn.broken || (conn.quit && conn.output.empty())
+               || (conn.inputClosed && conn.searching == 0 && conn.output.empty())){
+                closeConnection(id);
+            }else{
+                watch(id);
+            }
+        }
+    }
+}
+
+void Server::acceptClients(){
+    for(;;){
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0) return;
+        uint64_t id = addConnection(fd, fd, true);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = id;
+        if(epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0){
+            ::close(fd);
+            connections.erase(id);
+            continue;
+        }
+        connections[id].events = EPOLLIN;
+    }
+}
+
+// Reads what is there and runs every complete line; one read per wakeup so
+// a busy client cannot starve the others
+void Server::readInput(uint64_t id){
+    Connection &conn = connections[id];
+    if(conn.inputClosed) return;
+    char buffer[READ_CHUNK];
+    ssize_t got = read(conn.inFd, buffer, sizeof(buffer));
+    if(got < 0 && (errno == EAGAIN || errno == EINTR)) return;
+    const Clock::time_point received = Clock::now();
+    if(got <= 0){
+        conn.inputClosed = true;
+        if(!conn.isSocket && stdinPolled) epoll_ctl(epollFd, EPOLL_CTL_DEL, conn.inFd, nullptr);
+        if(!conn.input.empty()) handleRequest(id, conn.input, received);
+        conn.input.clear();
+        dirty.insert(id);
+        return;
+    }
+    conn.input.append(buffer, got);
+
+    size_t start = 0;
+    for(size_t end; (end = conn.input.find('\n', start)) != std::string::npos; start = end + 1){
+        if(end - start > MAX_LINE_LENGTH){
+            send(id, "error - line too long");
+            continue;
+        }
+        std::string line = conn.input.substr(start, end - start);
+        if(!line.empty() && line.back() == '\r') line.pop_back();
+        handleRequest(id, line, received);
+    }
+    conn.input.erase(0, start);
+    if(conn.input.size() > MAX_LINE_LENGTH){
+        conn.input.clear();
+        send(id, "error - line too long");
+    }
+    dirty.insert(id);
+}
+
+void Server::handleRequest(uint64_t id, const std::string &line, Clock::time_point received){
+    const std::vector<std::string> words = splitWords(line);
+    if(words.empty()) return;
+    const std::string &command = words[0];
+    std::string reply;
+    if(command == "new") reply = newGame(id, words);
+    else if(command == "position") reply = setPosition(id, words);
+    else if(command == "move") reply = playMove(id, words);
+    else if(command == "go") reply = startSearch(id, words, received);
+    else if(command == "stop") reply = stopSearch(id, words);
+    else if(command == "show") reply = showGame(id, words);
+    else if(command == "free") reply = freeGame(id, words);
+    else if(command == "stats") reply = statsLine();
+    else if(command == "ping") reply = "ok ping";
+    else if(command == "quit"){
+        reply = "ok quit";
+        connections[id].quit = true;
+        if(id == stdioId) connections[id].inputClosed = true;
+    }else{
+        reply = "error " + command + " unknown command";
+    }
+    send(id, reply);
+
+    requests++;
+    const bool known = std::find(std::begin(COMMANDS), std::end(COMMANDS), command) != std::end(COMMANDS);
+    latency[known ? command : "unknown"].add(microsSince(received));
+}
+
+ServerGame *Server::findGame(uint64_t id, const std::vector<std::string> &words, std::string &error){
+    long long gameId;
+    if(words.size() < 2 || !parseNumber(words[1], gameId)){
+        error = "error " + words[0] + " missing game id";
+        return nullptr;
+    }
+    auto it = games.find((uint64_t)gameId);
+    if(it == games.end() || it->second.connection != id || it->second.freed){
+        error = "error " + words[0] + " " + words[1] + " unknown game";
+        return nullptr;
+    }
+    return &it->second;
+}
+
+// new [factor [human|computer]]: a random opening factor and the human first by default
+std::string Server::newGame(uint64_t id, const std::vector<std::string> &words){
+    long long factor = MIN_FACTOR + (long long)(splitmix64(rng) % MAX_FACTOR);
+    int side = HUMAN_PLAYER;
+    if(words.size() > 3 || (words.size() > 1 && (!parseNumber(words[1], factor) || !isFactor((int)factor)))
+       || (words.size() > 2 && !parseSide(words[2], side))){
+        return "error new usage: new [factor [human|computer]]";
+    }
+    if(games.size() >= options.maxGames) return "error new too many games";
+    const uint64_t gameId = nextGameId++;
+    auto it = games.emplace(gameId, ServerGame{Game((int)factor, side), id, nullptr, false}).first;
+    connections[id].games.insert(gameId);
+    return "ok new " + std::to_string(gameId) + " " + gameStatus(it->second.game);
+}
+
+// position <id> <factor> <human|computer> <cells>, cells as printed by show
+std::string Server::setPosition(uint64_t id, const std::vector<std::string> &words){
+    std::string error;
+    ServerGame *game = findGame(id, words, error);
+    if(!game) return error;
+    long long factor;
+    int side;
+    Position pos;
+    if(words.size() != 5 || !parseNumber(words[2], factor) || !parseSide(words[3], side)
+       || !parseBoard(words[4], (int)factor, side, pos)){
+        return "error position " + words[1] + " usage: position <id> <factor> <human|computer> <cells>";
+    }
+    if(game->search) return "error position " + words[1] + " searching";
+    game->game = Game(pos);
+    return "ok position " + words[1] + " " + gameStatus(game->game);
+}
+
+std::string Server::playMove(uint64_t id, const std::vector<std::string> &words){
+    std::string error;
+    ServerGame *game = findGame(id, words, error);
+    if(!game) return error;
+    long long factor;
+    if(words.size() != 3 || !parseNumber(words[2], factor)) return "error move " + words[1] + " usage: move <id> <factor>";
+    if(game->search) return "error move " + words[1] + " searching";
+    if(game->game.isOver()) return "error move " + words[1] + " game over";
+    if(factor < MIN_FACTOR || factor > MAX_FACTOR || !game->game.play((int)factor)) return "error move " + words[1] + " illegal";
+    return "ok move " + words[1] + " cell " + std::to_string(game->game.lastCell()) + " " + gameStatus(game->game);
+}
+
+// go <id> [ms <n>] [depth <n>]: answered at once, the result follows as a bestmove line
+std::string Server::startSearch(uint64_t id, const std::vector<std::string> &words, Clock::time_point received){
+    std::string error;
+    ServerGame *game = findGame(id, words, error);
+    if(!game) return error;
+    long long timeMs = options.thinkMs, depth = MAX_SEARCH_DEPTH;
+    bool valid = words.size() % 2 == 0;
+    for(size_t i = 2; valid && i + 1 < words.size(); i += 2){
+        if(words[i] == "ms") valid = parseNumber(words[i + 1], timeMs) && timeMs > 0 && timeMs <= 3600000;
+        else if(words[i] == "depth") valid = parseNumber(words[i + 1], depth) && depth > 0;
+        else valid = false;
+    }
+    if(!valid) return "error go " + words[1] + " usage: go <id> [ms <n>] [depth <n>]";
+    if(game->search) return "error go " + words[1] + " searching";
+    if(game->game.isOver()) return "error go " + words[1] + " game over";
+
+    auto job = std::make_shared<SearchJob>();
+    job->gameId = std::strtoull(words[1].c_str(), nullptr, 10);
+    job->pos = game->game.position();
+    job->timeMs = (int)timeMs;
+    job->maxDepth = (int)std::min<long long>(depth, MAX_SEARCH_DEPTH);
+    job->received = received;
+    game->search = job;
+    connections[id].searching++;
+    pool->submit(job);
+    return "ok go " + words[1];
+}
+
+std::string Server::stopSearch(uint64_t id, const std::vector<std::string> &words){
+    std::string error;
+    ServerGame *game = findGame(id, words, error);
+    if(!game) return error;
+    if(!game->search) return "error stop " + words[1] + " not searching";
+    game->search->cancel = true;
+    return "ok stop " + words[1];
+}
+
+std::string Server::showGame(uint64_t id, const std::vector<std::string> &words){
+    std::string error;
+    ServerGame *game = findGame(id, words, error);
+    if(!game) return error;
+    const Position &pos = game->game.position();
+    return "ok show " + words[1] + " " + std::to_string(pos.activeFactor) + " " + sideName(pos.sideToMove)
+         + " " + boardString(pos) + " " + gameStatus(game->game);
+}
+
+// A game that is still searching is kept until its worker is done with it
+std::string Server::freeGame(uint64_t id, const std::vector<std::string> &words){
+    std::string error;
+    ServerGame *game = findGame(id, words, error);
+    if(!game) return error;
+    const uint64_t gameId = std::strtoull(words[1].c_str(), nullptr, 10);
+    if(game->search){
+        game->search->cancel = true;
+        game->freed = true;
+    }else{
+        games.erase(gameId);
+        connections[id].games.erase(gameId);
+    }
+    return "ok free " + words[1];
+}
+
+// Counters since start-up as name value pairs, then count, mean, p50, p99
+// and max microseconds per command; bestmove times a go from request to result
+std::string Server::statsLine(){
+    const double seconds = std::max(1e-6, microsSince(started) / 1e6);
+    char buffer[256];
+    std::snprintf(buffer, sizeof(buffer),
+                  "ok stats uptime_ms %llu connections %zu games %zu queued %zu running %zu"
+                  " requests %llu requests_per_s %.0f searches %llu searches_per_s %.1f nodes %llu nodes_per_s %.0f",
+                  (unsigned long long)(seconds * 1000), connections.size(), games.size(), pool->queued(), pool->running(),
+                  (unsigned long long)requests, requests / seconds, (unsigned long long)searches, searches / seconds,
+                  (unsigned long long)nodes, nodes / seconds);
+    std::string line = buffer;
+    for(const auto &entry : latency){
+        const LatencyStats &stats = entry.second;
+        std::snprintf(buffer, sizeof(buffer), " %s %llu %llu %llu %llu %llu", entry.first.c_str(),
+                      (unsigned long long)stats.count, (unsigned long long)(stats.totalUs / std::max<uint64_t>(1, stats.count)),
+                      (unsigned long long)stats.percentile(0.5), (unsigned long long)stats.percentile(0.99),
+                      (unsigned long long)stats.maxUs);
+        line += buffer;
+    }
+    return line;
+}
+
+void Server::finishSearches(){
+    uint64_t count;
+    ssize_t got = read(notifyFd, &count, sizeof(count));
+    (void)got;
+    std::vector<std::shared_ptr<SearchJob>> done;
+    pool->takeFinished(done);
+    for(const auto &job : done){
+        auto it = games.find(job->gameId);
+        if(it == games.end()) continue;
+        ServerGame &game = it->second;
+        game.search.reset();
+        searches++;
+        nodes += job->result.nodes;
+        latency["bestmove"].add(microsSince(job->received));
+
+        auto conn = connections.find(game.connection);
+        if(conn != connections.end()) conn->second.searching--;
+        if(game.freed || conn == connections.end()){
+            if(conn != connections.end()) conn->second.games.erase(job->gameId);
+            games.erase(it);
+            continue;
+        }
+        const SearchResult &r = job->result;
+        send(game.connection, "bestmove " + std::to_string(job->gameId) + " " + std::to_string(r.factor)
+             + " score " + std::to_string(r.score) + " depth " + std::to_string(r.depth)
+             + " nodes " + std::to_string(r.nodes) + " time_ms " + std::to_string(r.elapsedMs));
+    }
+}
+
+void Server::send(uint64_t id, const std::string &line){
+    Connection &conn = connections[id];
+    conn.output += line;
+    conn.output += '\n';
+    dirty.insert(id);
+}
+
+// Sockets and a polled stdout are non-blocking and keep what they could not
+// take; stdout on a file epoll cannot watch is written through
+void Server::flush(uint64_t id){
+    Connection &conn = connections[id];
+    size_t sent = 0;
+    while(sent < conn.output.size()){
+        ssize_t n = conn.isSocket
+            ? ::send(conn.outFd, conn.output.data() + sent, conn.output.size() - sent, MSG_NOSIGNAL)
+            : write(conn.outFd, conn.output.data() + sent, conn.output.size() - sent);
+        if(n > 0){
+            sent += n;
+        }else if(n < 0 && errno == EINTR){
+            continue;
+        }else if(n < 0 && errno == EAGAIN && (conn.isSocket || conn.outputPolled)){
+            break;
+        }else{
+            conn.broken = true;
+            break;
+        }
+    }
+    conn.output.erase(0, sent);
+}
+
+// Reads only while the replies are taken, and waits for room for the rest
+void Server::watch(uint64_t id){
+    Connection &conn = connections[id];
+    uint32_t events = 0;
+    if(!conn.inputClosed && conn.output.size() < MAX_PENDING_OUTPUT) events |= EPOLLIN;
+    if(!conn.output.empty()) events |= EPOLLOUT;
+    if(events == conn.events) return;
+    epoll_event ev{};
+    if(conn.isSocket){
+        ev.events = events;
+        ev.data.u64 = id;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.inFd, &ev);
+        conn.events = events;
+        return;
+    }
+    // stdin and stdout are registered apart. A paused stdin is removed rather
+    // than left with no events, as a pipe still reports its hang-up then
+    if(stdinPolled && !conn.inputClosed && ((events ^ conn.events) & EPOLLIN)){
+        ev.events = EPOLLIN;
+        ev.data.u64 = id;
+        epoll_ctl(epollFd, (events & EPOLLIN) ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, conn.inFd, &ev);
+    }
+    if(conn.outputPolled && ((events ^ conn.events) & EPOLLOUT)){
+        ev.events = events & EPOLLOUT;
+        ev.data.u64 = STDOUT_TAG;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.outFd, &ev);
+    }
+    conn.events = events;
+}
+
+// Searches of the connection's games are cancelled; their results are dropped
+void Server::closeConnection(uint64_t id){
+    Connection &conn = connections[id];
+    for(uint64_t gameId : conn.games){
+        auto it = games.find(gameId);
+        if(it == games.end()) continue;
+        if(it->second.search){
+            it->second.search->cancel = true;
+            it->second.freed = true;
+        }else{
+            games.erase(it);
+        }
+    }
+    if(conn.isSocket){
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, conn.inFd, nullptr);
+        ::close(conn.inFd);
+    }else{
+        if(stdinPolled) epoll_ctl(epollFd, EPOLL_CTL_DEL, conn.inFd, nullptr);
+        if(conn.outputPolled) epoll_ctl(epollFd, EPOLL_CTL_DEL, conn.outFd, nullptr);
+        // quit on the console stops the server; so does the end of its input without a socket
+        if(conn.quit || listenFd < 0) running = false;
+    }
+    connections.erase(id);
+}
+
+bool parseOptions(int argc, char **argv, ServerOptions &options){
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "--no-stdio"){
+            options.stdio = false;
+            continue;
+        }
+        if(i + 1 >= argc) return false;
+        const char *value = argv[++i];
+        if(arg == "--socket") options.socketPath = value;
+        else if(arg == "--workers") options.workers = std::atoi(value);
+        else if(arg == "--hash") options.hashMb = std::atoi(value);
+        else if(arg == "--think-ms") options.thinkMs = std::atoi(value);
+        else if(arg == "--max-games") options.maxGames = std::strtoull(value, nullptr, 10);
+        else if(arg == "--seed") options.seed = std::strtoull(value, nullptr, 10);
+        else return false;
+    }
+    return (options.stdio || !options.socketPath.empty()) && options.workers > 0 && options.hashMb > 0
+        && options.thinkMs > 0 && options.maxGames > 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv){
+    ServerOptions options;
+    if(!parseOptions(argc, argv, options)){
+        std::fprintf(stderr, "Usage: %s [--socket path] [--no-stdio] [--workers n] [--hash MB] [--think-ms ms]\n"
+                             "          [--max-games n] [--seed n]\n", argv[0]);
+        return 1;
+    }
+
+    // Blocked before the workers start so only the event loop sees them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+    int signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    Server server(options);
+    if(signalFd < 0 || !server.setUp(signalFd)){
+        std::fprintf(stderr, "Could not start the server: %s\n", std::strerror(errno));
+        return 1;
+    }
+    server.run();
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "slottable.h"
+#include "savefile.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct SlotTableHeader {
+    char magic[8];
+    uint64_t slotCount;   // power of two
+    uint64_t used;
+    uint64_t reserved;
+};
+
+} // namespace
+
+SlotTable::SlotTable(const char magic[8], uint64_t valueMask)
+    : magic(magic), valueMask(valueMask), probeShift(__builtin_popcountll(valueMask)){
+}
+
+SlotTable::~SlotTable(){
+    close();
+}
+
+bool SlotTable::open(const std::string &path){
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SlotTableHeader)){
+        ::close(fd);
+        return false;
+    }
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED) return false;
+
+    const SlotTableHeader *header = (const SlotTableHeader *)map;
+    uint64_t slotCount = header->slotCount;
+    bool valid = std::memcmp(header->magic, magic, sizeof(header->magic)) == 0
+              && slotCount > 0 && (slotCount & (slotCount - 1)) == 0
+              && sizeof(SlotTableHeader) + slotCount * sizeof(uint64_t) == (size_t)st.st_size;
+    if(!valid){
+        munmap(map, st.st_size);
+        return false;
+    }
+    mapping = map;
+    mappingSize = st.st_size;
+    slots = (const uint64_t *)((const char *)map + sizeof(SlotTableHeader));
+    mask = slotCount - 1;
+    used = header->used;
+    return true;
+}
+
+void SlotTable::close(){
+    if(mapping) munmap(mapping, mappingSize);
+    mapping = nullptr;
+    mappingSize = 0;
+    slots = nullptr;
+    mask = used = 0;
+}
+
+bool SlotTable::lookup(uint64_t key, uint64_t &slot) const {
+    if(!slots) return false;
+    const uint64_t tag = key & ~valueMask;
+    // A file with no empty slot left must not make a miss spin forever
+    const uint64_t first = key >> probeShift;
+    for(uint64_t i = first; i - first <= mask; i++){
+        slot = slots[i & mask];
+        if(slot == 0) return false;
+        if((slot & ~valueMask) == tag) return true;
+    }
+    return false;
+}
+
+bool writeSlotTable(const std::string &path, const char magic[8], uint64_t valueMask,
+                    const std::vector<uint64_t> &slots){
+    uint64_t slotCount = 1;
+    while(slotCount < slots.size() * 2) slotCount *= 2;
+    std::vector<uint64_t> table(slotCount, 0);
+    const uint64_t mask = slotCount - 1;
+    const int probeShift = __builtin_popcountll(valueMask);
+    for(uint64_t packed : slots){
+        for(uint64_t i = packed >> probeShift;; i++){
+            uint64_t &slot = table[i & mask];
+            if(slot == 0 || (slot & ~valueMask) == (packed & ~valueMask)){
+                slot = packed;
+                break;
+            }
+        }
+    }
+
+    SlotTableHeader header;
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.slotCount = slotCount;
+    header.used = slots.size();
+    header.reserved = 0;
+
+    std::string tempPath = path + ".tmp";
+    FILE *out = std::fopen(tempPath.c_str(), "wb");
+    if(!out) return false;
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1
+           && std::fwrite(table.data(), sizeof(uint64_t), slotCount, out) == slotCount;
+    return replaceFile(out, ok, tempPath, path);
+}
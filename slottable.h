@@ -0,0 +1,46 @@
+// slottable.h
+#ifndef SLOTTABLE_H
+#define SLOTTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Read-only view of a file holding an open-addressing hash table of 8-byte
+// slots, shared by the solved-position file and the opening book. A slot is
+// (key & ~valueMask) | value and 0 when empty; the bits of valueMask are the
+// low bits of the key, and probing starts at the key bits above them. The
+// file is mmapped, so opening it reads nothing but the header and a lookup
+// touches one or two pages however large the table is.
+class SlotTable {
+public:
+    SlotTable(const char magic[8], uint64_t valueMask);
+    ~SlotTable();
+    SlotTable(const SlotTable &) = delete;
+    SlotTable &operator=(const SlotTable &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const { return slots != nullptr; }
+    uint64_t size() const { return used; }
+    // The slot stored for `key`; probes at most every slot once
+    bool lookup(uint64_t key, uint64_t &slot) const;
+
+private:
+    const char *magic;
+    const uint64_t valueMask;
+    const int probeShift;        // key bits below the first probe index
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+    const uint64_t *slots = nullptr;
+    uint64_t mask = 0;
+    uint64_t used = 0;
+};
+
+// Builds a table of the packed `slots`, sized for a load factor of at most
+// one half so probes stay short, and writes it to `path` with replaceFile()
+bool writeSlotTable(const std::string &path, const char magic[8], uint64_t valueMask,
+                    const std::vector<uint64_t> &slots);
+
+#endif
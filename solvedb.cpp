@@ -0,0 +1,31 @@
+#include "solvedb.h"
+
+namespace {
+
+const char DB_MAGIC[8] = {'M', 'G', 'S', 'O', 'L', 'V', 'E', '1'};
+const uint64_t VALUE_MASK = 0x3F;
+
+uint64_t packSlot(const SolvedEntry &entry){
+    return (entry.key & ~VALUE_MASK) | (uint64_t)(entry.factor & 0xF) << 2 | (uint64_t)entry.result;
+}
+
+} // namespace
+
+SolvedDatabase::SolvedDatabase() : table(DB_MAGIC, VALUE_MASK){
+}
+
+bool SolvedDatabase::lookup(uint64_t key, SolvedEntry &entry) const {
+    uint64_t slot;
+    if(!table.lookup(key, slot)) return false;
+    entry.key = key;
+    entry.result = (SolvedResult)(slot & 0x3);
+    entry.factor = (int)((slot >> 2) & 0xF);
+    return true;
+}
+
+bool writeSolvedDatabase(const std::string &path, const std::vector<SolvedEntry> &entries){
+    std::vector<uint64_t> slots;
+    slots.reserve(entries.size());
+    for(const SolvedEntry &entry : entries) slots.push_back(packSlot(entry));
+    return writeSlotTable(path, DB_MAGIC, VALUE_MASK, slots);
+}
@@ -0,0 +1,41 @@
+// solvedb.h
+#ifndef SOLVEDB_H
+#define SOLVEDB_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "position.h"
+#include "slottable.h"
+
+const std::string SOLVED_DB_FILENAME = "multiplication" VARIANT_TAG "_solved.bin";
+
+// Game-theoretic value for the side to move
+enum SolvedResult { SOLVED_NONE = 0, SOLVED_WIN = 1, SOLVED_LOSS = 2, SOLVED_DRAW = 3 };
+
+struct SolvedEntry {
+    uint64_t key;        // Position::key
+    SolvedResult result;
+    int factor;          // best factor for the side to move
+};
+
+// Read-only view of a solved-position file: a SlotTable whose slots are
+// (key & ~0x3F) | factor << 2 | result
+class SolvedDatabase {
+public:
+    SolvedDatabase();
+
+    bool open(const std::string &path){ return table.open(path); }
+    void close(){ table.close(); }
+    bool isOpen() const { return table.isOpen(); }
+    uint64_t size() const { return table.size(); }
+    bool lookup(uint64_t key, SolvedEntry &entry) const;
+
+private:
+    SlotTable table;
+};
+
+// Writes a solved-position file that SolvedDatabase can open
+bool writeSolvedDatabase(const std::string &path, const std::vector<SolvedEntry> &entries);
+
+#endif
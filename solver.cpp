@@ -0,0 +1,225 @@
+// Offline solver: computes the exact win/loss/draw value and best factor of
+// every position reachable from a set of roots and writes them to a
+// solved-position database the game can mmap (see solvedb.h).
+#include "gamecore.h"
+#include "solvedb.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+struct SolverOptions {
+    int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    int plies = 0;                       // solve every position this many plies after the openings
+    uint64_t maxPositions = 200000000;   // give up instead of exhausting memory
+    std::string output = SOLVED_DB_FILENAME;
+    std::vector<std::string> fromFiles;  // save files to use as roots instead
+};
+
+// Memo of solved positions, sharded so the worker threads rarely contend
+class SolvedMemo {
+public:
+    bool find(uint64_t key, uint8_t &value){
+        Shard &shard = shards[key % SHARD_COUNT];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.values.find(key);
+        if(it == shard.values.end()) return false;
+        value = it->second;
+        return true;
+    }
+
+    void insert(uint64_t key, uint8_t value){
+        Shard &shard = shards[key % SHARD_COUNT];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if(shard.values.emplace(key, value).second) count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t size() const { return count.load(std::memory_order_relaxed); }
+
+    std::vector<SolvedEntry> entries(){
+        std::vector<SolvedEntry> out;
+        out.reserve(size());
+        for(Shard &shard : shards){
+            for(auto &kv : shard.values){
+                out.push_back({kv.first, (SolvedResult)(kv.second & 0x3), kv.second >> 2});
+            }
+        }
+        return out;
+    }
+
+private:
+    static const int SHARD_COUNT = 256;
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, uint8_t> values;
+    };
+    Shard shards[SHARD_COUNT];
+    std::atomic<uint64_t> count{0};
+};
+
+SolvedMemo memo;
+std::atomic<bool> overflow(false);
+uint64_t maxPositions = 0;
+
+// Exact value for the side to move: 1 win, 0 draw, -1 loss
+int solve(Position &pos, bool afterPass){
+    if(overflow.load(std::memory_order_relaxed)) return 0;
+    Bitboard legal = legalMoves(pos);
+    if(!legal){
+        if(afterPass) return 0;
+        makePass(pos);
+        int value = -solve(pos, true);
+        makePass(pos);
+        return value;
+    }
+    if(isDead(pos)) return 0;
+
+    uint8_t stored;
+    if(memo.find(pos.key, stored)){
+        SolvedResult result = (SolvedResult)(stored & 0x3);
+        return result == SOLVED_WIN ? 1 : result == SOLVED_LOSS ? -1 : 0;
+    }
+
+    const int side = pos.sideToMove;
+    const int previousFactor = pos.activeFactor;
+    int best = -2, bestFactor = 0;
+    for(int f = MIN_FACTOR; f <= MAX_FACTOR && best < 1; f++){
+        int cell = MOVE_CELL[previousFactor][f];
+        if((legal & (Bitboard(1) << cell)) && hasWinLineThrough(pos.bits[side] | (Bitboard(1) << cell), cell)){
+            best = 1;
+            bestFactor = f;
+        }
+    }
+    for(int f = MIN_FACTOR; f <= MAX_FACTOR && best < 1; f++){
+        int cell = MOVE_CELL[previousFactor][f];
+        if(!(legal & (Bitboard(1) << cell))) continue;
+        makeMove(pos, f);
+        int value = -solve(pos, false);
+        unmakeMove(pos, cell, previousFactor);
+        if(value > best){
+            best = value;
+            bestFactor = f;
+        }
+    }
+    if(overflow.load(std::memory_order_relaxed)) return 0;
+
+    SolvedResult result = best > 0 ? SOLVED_WIN : best < 0 ? SOLVED_LOSS : SOLVED_DRAW;
+    memo.insert(pos.key, (uint8_t)(result | bestFactor << 2));
+    if(memo.size() > maxPositions) overflow.store(true);
+    return best;
+}
+
+// Distinct non-terminal positions exactly `plies` marks after `pos`
+void collectFrontier(Position &pos, int plies, bool afterPass,
+                     std::unordered_set<uint64_t> &seen, std::vector<Position> &out){
+    Bitboard legal = legalMoves(pos);
+    if(!legal){
+        if(afterPass) return;
+        makePass(pos);
+        collectFrontier(pos, plies, true, seen, out);
+        makePass(pos);
+        return;
+    }
+    if(isDead(pos)) return;
+    if(plies == 0){
+        if(seen.insert(pos.key).second) out.push_back(pos);
+        return;
+    }
+    const int previousFactor = pos.activeFactor;
+    for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+        int cell = MOVE_CELL[previousFactor][f];
+        if(!(legal & (Bitboard(1) << cell))) continue;
+        makeMove(pos, f);
+        if(!wonAt(pos, cell, opponentOf(pos.sideToMove))) collectFrontier(pos, plies - 1, false, seen, out);
+        unmakeMove(pos, cell, previousFactor);
+    }
+}
+
+bool parseOptions(int argc, char **argv, SolverOptions &options){
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(i + 1 >= argc) return false;
+        const char *value = argv[++i];
+        if(arg == "--threads") options.threads = std::atoi(value);
+        else if(arg == "--plies") options.plies = std::atoi(value);
+        else if(arg == "--max-positions") options.maxPositions = std::strtoull(value, nullptr, 10);
+        else if(arg == "--output") options.output = value;
+        else if(arg == "--from") options.fromFiles.push_back(value);
+        else return false;
+    }
+    return options.threads > 0 && options.plies >= 0 && options.maxPositions > 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv){
+    SolverOptions options;
+    if(!parseOptions(argc, argv, options)){
+        std::fprintf(stderr, "Usage: %s [--threads n] [--plies n] [--max-positions n] "
+                             "[--output file] [--from save_file]...\n", argv[0]);
+        return 1;
+    }
+    maxPositions = options.maxPositions;
+
+    // Roots: the 18 opening situations, or the given save files
+    std::vector<Position> starts;
+    if(options.fromFiles.empty()){
+        for(int factor = MIN_FACTOR; factor <= MAX_FACTOR; factor++){
+            for(int side = HUMAN_PLAYER; side <= COMPUTER_PLAYER; side++){
+                Position pos;
+                clearPosition(pos, factor, side);
+                starts.push_back(pos);
+            }
+        }
+    }
+    for(const std::string &path : options.fromFiles){
+        Position pos;
+        if(!readSaveFile(path, pos)){
+            std::fprintf(stderr, "Could not read position from %s\n", path.c_str());
+            return 1;
+        }
+        starts.push_back(pos);
+    }
+
+    std::vector<Position> roots;
+    std::unordered_set<uint64_t> seen;
+    for(Position &start : starts) collectFrontier(start, options.plies, false, seen, roots);
+    std::printf("Solving %zu root positions on %d threads\n", roots.size(), options.threads);
+    std::fflush(stdout);
+
+    auto begin = std::chrono::steady_clock::now();
+    std::atomic<size_t> nextRoot(0);
+    std::vector<std::thread> workers;
+    for(int t = 0; t < options.threads; t++){
+        workers.emplace_back([&](){
+            for(size_t i = nextRoot++; i < roots.size() && !overflow; i = nextRoot++){
+                Position pos = roots[i];
+                solve(pos, false);
+            }
+        });
+    }
+    for(auto &worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    if(overflow){
+        std::fprintf(stderr, "Gave up after %llu positions; raise --max-positions or --plies\n",
+                     (unsigned long long)memo.size());
+        return 1;
+    }
+    std::vector<SolvedEntry> entries = memo.entries();
+    if(!writeSolvedDatabase(options.output, entries)){
+        std::fprintf(stderr, "Could not write %s\n", options.output.c_str());
+        return 1;
+    }
+    std::printf("Solved %zu positions in %.1f s, written to %s\n",
+                entries.size(), seconds, options.output.c_str());
+    return 0;
+}
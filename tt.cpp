@@ -0,0 +1,99 @@
+#include "tt.h"
+
+namespace {
+
+// data layout: score:32 | depth:8 | bound:2 | factor:4 | generation:8
+uint64_t packData(int score, int depth, Bound bound, int factor, uint8_t generation){
+    return (uint64_t)(uint32_t)score
+         | (uint64_t)(uint8_t)depth << 32
+         | (uint64_t)bound << 40
+         | (uint64_t)(factor & 0xF) << 42
+         | (uint64_t)generation << 46;
+}
+
+int dataDepth(uint64_t data){ return (int)(uint8_t)(data >> 32); }
+Bound dataBound(uint64_t data){ return (Bound)((data >> 40) & 0x3); }
+uint8_t dataGeneration(uint64_t data){ return (uint8_t)(data >> 46); }
+
+} // namespace
+
+TranspositionTable::TranspositionTable(){
+    resize(DEFAULT_HASH_MB);
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes){
+    resize(megabytes);
+}
+
+// Rounds down to a power-of-two number of slots so indexing is a mask
+void TranspositionTable::resize(size_t megabytes){
+    if(megabytes < 1) megabytes = 1;
+    size_t wanted = (megabytes << 20) / sizeof(Entry);
+    size_t count = 1;
+    while(count * 2 <= wanted) count *= 2;
+    entries.reset(new Entry[count]);
+    entryCount = count;
+    mask = count - 1;
+    clear();
+}
+
+void TranspositionTable::clear(){
+    for(size_t i = 0; i < entryCount; i++){
+        entries[i].check.store(0, std::memory_order_relaxed);
+        entries[i].data.store(0, std::memory_order_relaxed);
+    }
+    generation = 0;
+    probeCount.store(0, std::memory_order_relaxed);
+    hitCount.store(0, std::memory_order_relaxed);
+}
+
+void TranspositionTable::newSearch(){
+    generation++;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTHit &hit) const {
+    const Entry &entry = entries[key & mask];
+    uint64_t data = entry.data.load(std::memory_order_relaxed);
+    uint64_t check = entry.check.load(std::memory_order_relaxed);
+    if((check ^ data) != key || dataBound(data) == BOUND_NONE) return false;
+    hit.score = (int)(int32_t)(uint32_t)data;
+    hit.depth = dataDepth(data);
+    hit.bound = dataBound(data);
+    hit.factor = (int)((data >> 42) & 0xF);
+    return true;
+}
+
+// Keeps deeper results from the current search, everything else is overwritten
+void TranspositionTable::store(uint64_t key, int score, int depth, Bound bound, int factor){
+    Entry &entry = entries[key & mask];
+    uint64_t old = entry.data.load(std::memory_order_relaxed);
+    uint64_t oldKey = entry.check.load(std::memory_order_relaxed) ^ old;
+    if(oldKey != key && dataGeneration(old) == generation && dataDepth(old) > depth
+       && dataBound(old) != BOUND_NONE){
+        return;
+    }
+    if(factor == 0 && oldKey == key) factor = (int)((old >> 42) & 0xF);
+    uint64_t data = packData(score, depth, bound, factor, generation);
+    entry.check.store(key ^ data, std::memory_order_relaxed);
+    entry.data.store(data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::recordProbes(uint64_t probes, uint64_t hits){
+    probeCount.fetch_add(probes, std::memory_order_relaxed);
+    hitCount.fetch_add(hits, std::memory_order_relaxed);
+}
+
+double TranspositionTable::hitRate() const {
+    uint64_t p = probes();
+    return p ? (double)hits() / p : 0.0;
+}
+
+int TranspositionTable::fillPermille() const {
+    size_t sample = entryCount < 1000 ? entryCount : 1000;
+    int used = 0;
+    for(size_t i = 0; i < sample; i++){
+        uint64_t data = entries[i].data.load(std::memory_order_relaxed);
+        if(dataBound(data) != BOUND_NONE && dataGeneration(data) == generation) used++;
+    }
+    return sample ? (int)(used * 1000 / sample) : 0;
+}
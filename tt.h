@@ -0,0 +1,58 @@
+// tt.h
+#ifndef TT_H
+#define TT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+const int DEFAULT_HASH_MB = 16;
+
+enum Bound { BOUND_NONE = 0, BOUND_UPPER = 1, BOUND_LOWER = 2, BOUND_EXACT = 3 };
+
+struct TTHit {
+    int score;
+    int depth;
+    Bound bound;
+    int factor;   // best factor found, 0 if none
+};
+
+// Fixed-size hash table shared by search threads without locks.
+// Each slot stores (key ^ data, data); a torn write from a racing thread
+// fails the key check on probe and is treated as a miss.
+class TranspositionTable {
+public:
+    TranspositionTable();
+    explicit TranspositionTable(size_t megabytes);
+
+    void resize(size_t megabytes);
+    void clear();
+    void newSearch();    // ages existing entries so they are replaced first
+
+    bool probe(uint64_t key, TTHit &hit) const;
+    void store(uint64_t key, int score, int depth, Bound bound, int factor);
+
+    // Statistics are accumulated by the searchers and added once per search
+    void recordProbes(uint64_t probes, uint64_t hits);
+    uint64_t probes() const { return probeCount.load(std::memory_order_relaxed); }
+    uint64_t hits() const { return hitCount.load(std::memory_order_relaxed); }
+    double hitRate() const;
+    int fillPermille() const;   // sampled share of slots used by the current search
+    size_t sizeMb() const { return (entryCount * sizeof(Entry)) >> 20; }
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    size_t entryCount = 0;
+    size_t mask = 0;
+    uint8_t generation = 0;
+    std::atomic<uint64_t> probeCount{0};
+    std::atomic<uint64_t> hitCount{0};
+};
+
+#endif
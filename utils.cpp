@@ -1,12 +1,47 @@
 #include "utils.h"
 #include "game.h"
 #include "board.h"
+#include "movegen.h"
+#include "movescore.h"
+#include "search.h"
+#include "config.h"
+#include "mcts.h"
+#include "ponder.h"
+#include "savefile.h"
+#include "journal.h"
+#include "menu.h"
+#include "metrics.h"
 #include <fstream>
-#include <sstream>
+#include <iterator>
 #include <string>
 #include <thread>
 #include <chrono>
 #include <cctype>
+#include <ctime>
+
+// Shared by every computer move so results carry over between turns
+TranspositionTable searchTable;
+// Nodes searched by each worker thread over the whole session
+std::vector<uint64_t> searchThreadNodes;
+// Perfect answers for solved positions, mmapped by main() when the file exists
+SolvedDatabase solvedDatabase;
+// Searched opening replies, mmapped by main() when the file exists, and how many were played
+OpeningBook openingBook;
+uint64_t bookMoves = 0;
+// Created by main() for --engine mcts; keeps its tree between turns
+std::unique_ptr<MctsEngine> mctsEngine;
+// Playouts and thinking time of the MCTS engine over the whole session
+uint64_t mctsPlayouts = 0;
+uint64_t mctsElapsedMs = 0;
+// Replies searched while the human was thinking, and how often one was used
+Ponderer ponderer;
+uint64_t ponderHits = 0;
+uint64_t ponderMisses = 0;
+// Depth of the last timed search; a pondered reply must match it to be played as is
+int lastSearchDepth = 0;
+const int PONDER_MIN_DEPTH = 8;
+// Move log of the game being played, for crash recovery and the replay viewer
+JournalWriter gameJournal;
 
 // Creates a new ncurses window with a border
 WINDOW *create_newwin(int height, int width, int starty, int startx){
@@ -18,118 +53,366 @@ WINDOW *create_newwin(int height, int width, int starty, int startx){
     if(startx + width > COLS) width = COLS - startx;
     WINDOW *local_win = newwin(height, width, starty, startx);
     box(local_win, 0, 0);
-    wrefresh(local_win);
+    wnoutrefresh(local_win);   // shown by the caller's own refresh
     return local_win;
 }
 
-// Destroys an ncurses window properly
+// Destroys an ncurses window and repaints the stdscr rows it covered
 void destroy_win(WINDOW *local_win){
     if(local_win){
-        wborder(local_win, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ');
-        wrefresh(local_win);
+        int top = getbegy(local_win), height = getmaxy(local_win);
         delwin(local_win);
+        touchline(stdscr, top, height);
+        wnoutrefresh(stdscr);
+        doupdate();
     }
 }
 
-void showTempMessage(const std::string& message, int color_pair_attr, int height,
-    int desired_width, int duration_ms, int y_offset_from_bottom){
+// Draws a message box and leaves it on screen; returns nullptr if it fell back to the status line
+WINDOW *showMessageWindow(const std::string& message, int color_pair_attr, int height,
+    int desired_width, int y_offset_from_bottom){
     if(LINES <= height + y_offset_from_bottom || COLS <= desired_width){
        mvprintw(LINES - 1, 0, "Msg: %s", message.c_str());
        refresh();
-       std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
-       return;
+       return nullptr;
     }
     int win_width = desired_width;
     int win_y = LINES - height - y_offset_from_bottom;
     int win_x = (COLS - win_width) / 2;
     WINDOW *msg_win = create_newwin(height, win_width, win_y, win_x);
-    if(!msg_win) return;
+    if(!msg_win) return nullptr;
     wattron(msg_win, color_pair_attr);
     int text_x = (win_width - message.length()) / 2;
     if(text_x < 1) text_x = 1;
     mvwprintw(msg_win, height / 2, text_x, "%s", message.c_str());
     wattroff(msg_win, color_pair_attr);
     wrefresh(msg_win);
-    std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
-    destroy_win(msg_win);
+    return msg_win;
 }
 
-// Saves the current game state to a file
-bool saveGame(const GameState &state){
-    std::ofstream outFile(SAVE_FILENAME);
-    if(!outFile.is_open()){
-        std::string error = "Error: Could not open save file '" + SAVE_FILENAME + "' for writing!";
-        showTempMessage(error, COLOR_PAIR(1) | A_BOLD, 3, error.length() + 4, 2500);
-        return false;
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Toast {
+    std::string message;
+    int attr = 0;
+    Clock::time_point expires;
+    bool active = false;
+};
+
+// Only the newest message is shown; a new toast replaces the old one
+Toast toast;
+
+void drawToastLine(){
+    move(LINES - 1, 0);
+    clrtoeol();
+    if(toast.active){
+        int x = std::max(0, (COLS - (int)toast.message.length()) / 2);
+        attron(toast.attr);
+        mvprintw(LINES - 1, x, "%.*s", COLS, toast.message.c_str());
+        attroff(toast.attr);
+    }
+    wnoutrefresh(stdscr);
+}
+
+} // namespace
+
+void showTempMessage(const std::string& message, int color_pair_attr, int duration_ms){
+    toast.message = message;
+    toast.attr = color_pair_attr;
+    toast.expires = Clock::now() + std::chrono::milliseconds(duration_ms);
+    toast.active = true;
+    drawToastLine();
+    doupdate();
+}
+
+void dismissToasts(){
+    if(!toast.active) return;
+    toast.active = false;
+    drawToastLine();
+    doupdate();
+}
+
+int waitForKey(WINDOW *win, int timeout_ms){
+    const bool forever = timeout_ms < 0;
+    const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(forever ? 0 : timeout_ms);
+    drawToastLine();
+    doupdate();
+    int ch = ERR;
+    while(true){
+        Clock::time_point now = Clock::now();
+        if(toast.active && now >= toast.expires) dismissToasts();
+        if(!forever && now >= deadline) break;
+
+        // Sleep in wgetch until a key, the toast's expiry or the deadline, whichever is first
+        long wait = -1;
+        if(toast.active) wait = std::chrono::duration_cast<std::chrono::milliseconds>(toast.expires - now).count() + 1;
+        if(!forever){
+            long left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+            if(wait < 0 || left < wait) wait = left;
+        }
+        wtimeout(win, (int)wait);
+        ch = wgetch(win);
+        if(ch == KEY_RESIZE){
+            relayoutBoard();
+            if(win != stdscr){
+                touchwin(win);
+                wnoutrefresh(win);
+            }
+            drawToastLine();
+            doupdate();
+            continue;
+        }
+        if(ch != ERR){
+            dismissToasts();
+            break;
+        }
     }
-    // 1. Save GameState (activeFactor and whose turn it is)
-    outFile << state.activeFactor << std::endl;
-    outFile << (state.humanTurn ? 1 : 0) << std::endl; // Save boolean as 1 or 0
-    // 2. Save the moveOwner board (which player owns which cell)
-    for(int i = 0; i < BOARD_SIZE; ++i){
-        for(int j = 0; j < BOARD_SIZE; ++j){
-            outFile << moveOwner[i][j] << (j == BOARD_SIZE - 1 ? "" : " ");
+    wtimeout(win, -1);
+    return ch;
+}
+
+void pauseUi(int ms){
+    if(gameConfig.fastMode || ms <= 0) return;
+    int ch = waitForKey(stdscr, ms);
+    if(ch != ERR) ungetch(ch);   // typed ahead: leave it for the next prompt
+}
+
+// Saves into the game's own slot, else the first free one, else the oldest
+bool saveGame(GameState &state){
+    std::vector<SaveSlot> slots;
+    readSaveSlots(SAVE_SLOTS_FILENAME, slots);
+    int index = state.saveSlot;
+    if(index < 0){
+        for(int i = 0; i < SAVE_SLOT_COUNT && index < 0; i++){
+            if(!slots[i].used) index = i;
+        }
+    }
+    if(index < 0){
+        index = 0;
+        for(int i = 1; i < SAVE_SLOT_COUNT; i++){
+            if(slots[i].savedAt < slots[index].savedAt) index = i;
         }
-        outFile << std::endl;
     }
-    outFile.close();
+    time_t now = time(nullptr);
+    char name[SAVE_NAME_LENGTH + 1];
+    strftime(name, sizeof(name), "Game %d %b %H:%M:%S", localtime(&now));
+    if(!writeSaveSlot(SAVE_SLOTS_FILENAME, index, name, currentPosition(state), (int64_t)now)){
+        std::string error = "Error: Could not write save file '" + SAVE_SLOTS_FILENAME + "'!";
+        showTempMessage(error, COLOR_PAIR(1) | A_BOLD, 2500);
+        return false;
+    }
+    state.saveSlot = index;
     return true;
 }
 
 // Reset the ownership of all board cells to NO_PLAYER
 void resetGameMarkings() {
-    for(int i = 0; i < BOARD_SIZE; i++){
-        for(int j = 0; j < BOARD_SIZE; j++){
-            moveOwner[i][j] = NO_PLAYER;
-        }
-    }
+    playerBits[HUMAN_PLAYER] = 0;
+    playerBits[COMPUTER_PLAYER] = 0;
+    liveLines[HUMAN_PLAYER] = NUM_WIN_LINES;
+    liveLines[COMPUTER_PLAYER] = NUM_WIN_LINES;
 }
 
+// Picks a slot from the binary save file, or the old text save to migrate it
 bool loadGame(GameState &state){
-    std::ifstream inFile(SAVE_FILENAME);
-    if(!inFile.is_open()){
-        return false; // Indicate failure (no save file found)
+    std::vector<SaveSlot> slots;
+    readSaveSlots(SAVE_SLOTS_FILENAME, slots);
+    std::vector<std::string> entries;
+    std::vector<int> slotOfEntry;
+    for(int i = 0; i < (int)slots.size(); i++){
+        if(!slots[i].used) continue;
+        int marks = popCount(occupied(slots[i].pos));
+        entries.push_back(slots[i].name + "  (" + std::to_string(marks) + " marks)");
+        slotOfEntry.push_back(i);
     }
-    std::string line;
-    int turnFlag;
-    // 1. Load GameState
-    if(!(inFile >> state.activeFactor)){ inFile.close(); return false; }
-    if(!(inFile >> turnFlag)){ inFile.close(); return false; }
-    state.humanTurn = (turnFlag == 1);
-    inFile.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    // 2. Load moveOwner board
-    for(int i = 0; i < BOARD_SIZE; ++i){
-        if(!std::getline(inFile, line)){ inFile.close(); return false; }
-        std::stringstream ss(line);
-        for(int j = 0; j < BOARD_SIZE; ++j){
-            if(!(ss >> moveOwner[i][j])){ inFile.close(); return false; }
-            if(moveOwner[i][j] != NO_PLAYER && moveOwner[i][j] != HUMAN_PLAYER 
-                && moveOwner[i][j] != COMPUTER_PLAYER){
-                inFile.close(); return false;
-            }
-        }
+    if(std::ifstream(SAVE_FILENAME).good()){
+        entries.push_back("Old text save (" + SAVE_FILENAME + ")");
+        slotOfEntry.push_back(-1);
+    }
+    if(entries.empty()) return false;
+    int choice = showListMenu("- LOAD GAME -", entries);
+    if(choice < 0) return false;
+    if(slotOfEntry[choice] < 0) return loadTextSave(state);
+
+    SaveSlot slot;
+    if(!readSaveSlot(SAVE_SLOTS_FILENAME, slotOfEntry[choice], slot)) return false;
+    loadPosition(slot.pos, state);
+    state.saveSlot = slotOfEntry[choice];
+    return true;
+}
+
+// Offers to continue a game the journal shows was never finished. A declined
+// or already decided game is closed off so it is not offered again.
+bool recoverJournal(GameState &state){
+    JournalReplay journal;
+    if(!journal.load(JOURNAL_FILENAME) || journal.finished()) return false;
+    if(!gameJournal.resume(JOURNAL_FILENAME, journal.validBytes(), journal.plies())) return false;
+    const int plies = journal.plies();
+    const Position pos = journal.positionAt(plies);
+    int decided = isDead(pos) ? DRAW_RESULT : NO_PLAYER;
+    if(plies > 0 && journal.ply(plies).event == JOURNAL_MOVE && wonAt(pos, journal.ply(plies).cell, journal.ply(plies).player)){
+        decided = journal.ply(plies).player;
     }
-    inFile.close();
-    if(state.activeFactor < 1 || state.activeFactor > 9){
-        resetGameMarkings();
+    if(decided != NO_PLAYER){
+        gameJournal.end(decided);
         return false;
     }
+    std::vector<std::string> entries = {
+        "Resume it (" + std::to_string(plies) + (plies == 1 ? " move played)" : " moves played)"),
+        "Discard it"
+    };
+    if(showListMenu("- UNFINISHED GAME FOUND -", entries) != 0){
+        gameJournal.end(NO_PLAYER);
+        return false;
+    }
+    // Rebuilt ply by ply so the resumed game can still be undone
+    loadPosition(journal.positionAt(0), state);
+    for(int i = 1; i <= plies; i++){
+        if(journal.ply(i).event == JOURNAL_PASS) state.history.pass();
+        else state.history.make(journal.ply(i).factor);
+    }
+    restoreFromHistory(state);
+    return true;
+}
 
+// The original text format, kept so old saves can be loaded and saved again as a slot
+bool loadTextSave(GameState &state){
+    std::ifstream inFile(SAVE_FILENAME, std::ios::binary);
+    if(!inFile.is_open()){
+        return false; // Indicate failure (no save file found)
+    }
+    std::string text((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+    const char *cursor = text.data();
+    Position pos;
+    if(parseTextPosition(cursor, text.data() + text.size(), pos) != TEXT_VALID) return false;
+    loadPosition(pos, state);
     return true;
 }
 
-// AI logic to choose the best factor
+namespace {
+
+// Copies what a search reports into the move's metrics, scores turned to the computer's view
+void recordSearch(const SearchResult &result, MoveMetrics &metrics){
+    metrics.nodes = result.nodes;
+    metrics.depth = result.depth;
+    metrics.ttProbes = result.ttProbes;
+    metrics.ttHits = result.ttHits;
+    metrics.hasScore = true;
+    metrics.score = result.score;
+    metrics.factorScores.assign(result.factorScores.size(), NO_FACTOR_SCORE);
+    metrics.factorUpper.assign(result.factorScores.size(), false);
+    for(size_t f = 0; f < result.factorScores.size(); f++){
+        if(result.factorScores[f] == -INFINITE_SCORE) continue;
+        metrics.factorScores[f] = result.factorScores[f];
+        metrics.factorUpper[f] = result.factorBounds[f] == BOUND_UPPER;
+    }
+}
+
+int chooseFactor(const GameState &state, const Position &pos, MoveMetrics &metrics){
+    SolvedEntry solved;
+    if(solvedDatabase.lookup(pos.key, solved) && isLegalFactor(pos, solved.factor)){
+        metrics.source = "solved";
+        return solved.factor;
+    }
+    BookEntry booked;
+    if(gameConfig.engine == ENGINE_ALPHABETA && openingBook.lookup(pos.key, booked) && isLegalFactor(pos, booked.factor)){
+        bookMoves++;
+        metrics.source = "book";
+        metrics.depth = booked.depth;
+        return booked.factor;
+    }
+    if(gameConfig.engine == ENGINE_GREEDY || (gameConfig.engine == ENGINE_MCTS && !mctsEngine)){
+        metrics.source = "greedy";
+        return greedyChooseFactor(state, &metrics.factorScores);
+    }
+    if(gameConfig.engine == ENGINE_MCTS){
+        MctsLimits limits;
+        limits.timeMs = gameConfig.thinkMs;
+        limits.threads = gameConfig.threads;
+        limits.seed = (uint64_t)rand() << 32 | (uint64_t)rand();
+        MctsResult result = mctsEngine->search(pos, limits);
+        mctsPlayouts += result.playouts;
+        mctsElapsedMs += result.elapsedMs;
+        metrics.source = "mcts";
+        metrics.nodes = result.playouts;
+        metrics.hasScore = true;
+        metrics.score = (int)(result.winRate * 100.0 + 0.5);
+        return result.factor;
+    }
+    if(gameConfig.ponder && gameConfig.engine == ENGINE_ALPHABETA){
+        SearchResult pondered;
+        int wanted = std::min(gameConfig.maxDepth, std::max(lastSearchDepth, PONDER_MIN_DEPTH));
+        if(ponderer.lookup(pos.key, pondered) && pondered.factor > 0
+           && (pondered.depth >= wanted || isWinScore(pondered.score))){
+            ponderHits++;
+            metrics.source = "ponder";
+            recordSearch(pondered, metrics);
+            return pondered.factor;
+        }
+        ponderMisses++;
+    }
+    SearchLimits limits;
+    limits.timeMs = gameConfig.thinkMs;
+    limits.maxDepth = gameConfig.maxDepth;
+    limits.table = &searchTable;
+    limits.threads = gameConfig.threads;
+    SearchResult result = searchBestFactor(pos, limits);
+    lastSearchDepth = result.depth;
+    if(searchThreadNodes.size() < result.threadNodes.size()) searchThreadNodes.resize(result.threadNodes.size());
+    for(size_t i = 0; i < result.threadNodes.size(); i++) searchThreadNodes[i] += result.threadNodes[i];
+    metrics.source = "search";
+    recordSearch(result, metrics);
+    return result.factor;
+}
+
+} // namespace
+
+// AI logic to choose the best factor: alpha-beta search within the think
+// budget. What the choice cost is kept in lastMoveMetrics and logged.
 int computerChooseFactor(const GameState &state){
+    auto start = std::chrono::steady_clock::now();
+    Position pos = currentPosition(state);
+    MoveMetrics metrics;
+    int factor = chooseFactor(state, pos, metrics);
+    metrics.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    metrics.factor = factor;
+    metrics.ply = (int)state.history.size();
+    metrics.key = pos.key;
+    lastMoveMetrics = std::move(metrics);
+    moveMetricsVersion++;
+    metricsLog.append(lastMoveMetrics);
+    return factor;
+}
+
+void startPondering(const GameState &state){
+    if(!gameConfig.ponder || gameConfig.engine != ENGINE_ALPHABETA) return;
+    SearchLimits limits;
+    limits.maxDepth = gameConfig.maxDepth;
+    limits.table = &searchTable;
+    limits.threads = gameConfig.threads;
+    ponderer.start(currentPosition(state), limits);
+}
+
+void stopPondering(){
+    ponderer.stop();
+}
+
+// One-ply heuristic: win, else block, else best evaluateMove() score (scored together by evaluateMoves()).
+// The scores by factor go to `factorScores` when given; a win or a block returns before scoring.
+int greedyChooseFactor(const GameState &state, std::vector<int> *factorScores){
     int bestFactor = -1;
     int maxScore = std::numeric_limits<int>::min();
     int blockingFactor = -1;
     std::vector<int> possibleFactors;
-    for(int f = 1; f <= 9; f++){
-        if(isValidMove(f * state.activeFactor)){
+    const Bitboard legal = legalMoves(state.activeFactor, occupiedBits());
+    if(!legal) return -1;
+    for(int f = MIN_FACTOR; f <= MAX_FACTOR; f++){
+        if(legal & (Bitboard(1) << MOVE_CELL[state.activeFactor][f])){
             possibleFactors.push_back(f);
         }
     }
-    if(possibleFactors.empty()) return -1;
     // 1. Check for Computer Win
     for(int f : possibleFactors){
         if(wouldWin(f * state.activeFactor, COMPUTER_PLAYER)){
@@ -137,25 +420,23 @@ int computerChooseFactor(const GameState &state){
         }
     }
     // 2. Check for Human Win Block
-    for(int human_f = 1; human_f <= 9; human_f++){
-        int human_product = human_f * state.activeFactor;
-        if(isValidMove(human_product) && wouldWin(human_product, HUMAN_PLAYER)){
-            for(int comp_f : possibleFactors){
-                if(comp_f * state.activeFactor == human_product){
-                    blockingFactor = comp_f;
-                    break;
-                }
-            }
+    for(int f : possibleFactors){
+        if(wouldWin(f * state.activeFactor, HUMAN_PLAYER)){
+            blockingFactor = f;
+            break;
         }
-        if(blockingFactor != -1) break;
     }
     if(blockingFactor != -1) return blockingFactor;
-    for(int f : possibleFactors){
-        int product = f * state.activeFactor;
-        int currentScore = evaluateMove(product, COMPUTER_PLAYER);
-        if(currentScore > maxScore){
-            maxScore = currentScore;
-            bestFactor = f;
+    int products[MAX_FACTOR];
+    int scores[MAX_FACTOR];
+    for(size_t i = 0; i < possibleFactors.size(); i++) products[i] = possibleFactors[i] * state.activeFactor;
+    evaluateMoves(products, (int)possibleFactors.size(), COMPUTER_PLAYER, scores);
+    if(factorScores) factorScores->assign(MAX_FACTOR + 1, NO_FACTOR_SCORE);
+    for(size_t i = 0; i < possibleFactors.size(); i++){
+        if(factorScores) (*factorScores)[possibleFactors[i]] = scores[i];
+        if(scores[i] > maxScore){
+            maxScore = scores[i];
+            bestFactor = possibleFactors[i];
         }
     }
     // random move if no best factor found
@@ -3,18 +3,52 @@
 
 #include <ncurses.h>
 #include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
 #include <fstream>
 #include <sstream>
 #include <thread>
 #include <chrono>
 
 struct GameState;
+class TranspositionTable;
+class SolvedDatabase;
+class OpeningBook;
+class MctsEngine;
+class JournalWriter;
 
-void showTempMessage(const std::string& message, int color_pair_attr, int height,
-                     int desired_width, int duration_ms, int y_offset_from_bottom = 4);
-bool saveGame(const GameState &state);
+extern TranspositionTable searchTable;
+extern std::vector<uint64_t> searchThreadNodes;
+extern SolvedDatabase solvedDatabase;
+extern OpeningBook openingBook;
+extern uint64_t bookMoves;
+extern std::unique_ptr<MctsEngine> mctsEngine;
+extern uint64_t mctsPlayouts;
+extern uint64_t mctsElapsedMs;
+extern uint64_t ponderHits;
+extern uint64_t ponderMisses;
+extern JournalWriter gameJournal;
+
+WINDOW *showMessageWindow(const std::string& message, int color_pair_attr, int height,
+                          int desired_width, int y_offset_from_bottom = 4);
+// Toast on the bottom row until duration_ms passes or a key is pressed; never blocks
+void showTempMessage(const std::string& message, int color_pair_attr, int duration_ms);
+void dismissToasts();
+// Event loop: reads a key from win while expiring toasts, ERR once timeout_ms (-1 = never) passes
+int waitForKey(WINDOW *win, int timeout_ms = -1);
+// Pacing pause of up to ms that a key press cuts short; no-op in fast mode
+void pauseUi(int ms);
+bool saveGame(GameState &state);
 bool loadGame(GameState &state);
+bool loadTextSave(GameState &state);
+// Startup check of the journal for a game cut short by a crash; true if the player resumes it
+bool recoverJournal(GameState &state);
 int computerChooseFactor(const GameState &state);
+// Background search of the computer's replies during the human's turn (--ponder)
+void startPondering(const GameState &state);
+void stopPondering();
+int greedyChooseFactor(const GameState &state, std::vector<int> *factorScores = nullptr);
 WINDOW *create_newwin(int height, int width, int starty, int startx);
 void destroy_win(WINDOW *local_win);
 void resetGameMarkings();
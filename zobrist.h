@@ -0,0 +1,37 @@
+// zobrist.h
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <array>
+#include <cstdint>
+#include "bitboard.h"
+#include "movegen.h"
+
+// Compile-time splitmix64 so the keys are identical across builds and runs
+constexpr uint64_t splitmix64(uint64_t &state){
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+struct ZobristKeys {
+    uint64_t cell[3][NUM_CELLS];        // indexed by player, slot 0 unused
+    uint64_t factor[MAX_FACTOR + 1];    // active factor
+    uint64_t computerToMove;
+};
+
+constexpr ZobristKeys buildZobristKeys(){
+    ZobristKeys keys{};
+    uint64_t state = 0x4D554C5449504C59ULL;
+    for(int p = HUMAN_PLAYER; p <= COMPUTER_PLAYER; p++){
+        for(int c = 0; c < NUM_CELLS; c++) keys.cell[p][c] = splitmix64(state);
+    }
+    for(int f = 0; f <= MAX_FACTOR; f++) keys.factor[f] = splitmix64(state);
+    keys.computerToMove = splitmix64(state);
+    return keys;
+}
+
+constexpr ZobristKeys ZOBRIST = buildZobristKeys();
+
+#endif